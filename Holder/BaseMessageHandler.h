@@ -3,6 +3,7 @@
 #include "Messaging.h"
 #include "BaseMessageDispatch.h"
 #include "QueueManager.h"
+#include "TypeTagDisp.h"
 
 #include <memory>
 
@@ -18,6 +19,11 @@ namespace holder::messages
 	protected:
 		using Client = typename Derived::Client;
 
+		// Handlers borrow the message for the length of the call:
+		// void OnXxx(IMessage& rMsg, DispatchID dispatchID).  One that needs to keep the
+		// message can override OnMessage, which still receives the shared_ptr
+		using MessageDispatch = base::types::TypeTagsDisp<Derived, IMessage, DispatchID>;
+
 		class BaseClient
 		{
 		public:
@@ -25,6 +31,7 @@ namespace holder::messages
 			BaseClient(QueueID queueID, 
 				messages::DispatchID dispatchID,
 				std::shared_ptr<BaseMessageHandler> pListener)
+				:m_queueID(queueID)
 			{
 				CreateReceiverArgs rcvrArgs;
 				rcvrArgs.dispatchId = dispatchID;
@@ -37,7 +44,7 @@ namespace holder::messages
 
 			~BaseClient()
 			{
-				QueueManager::GetInstance().RemoveReceiver(m_receiverID);
+				QueueManager::GetInstance().RemoveReceiver(m_queueID, m_receiverID);
 			}
 
 			std::shared_ptr<ISenderEndpoint>
@@ -65,11 +72,12 @@ namespace holder::messages
 		{
 			Derived* pThisDerived = static_cast<Derived*>(this);
 
-			MessageDispatch<Derived>& dispTable = GetMessageDispatchTable();
+			MessageDispatch& dispTable = GetMessageDispatchTable();
+			IMessage& rMsg = *pMsg;
 
 			if (!dispTable(pThisDerived, 
-				pMsg->GetTag(),
-				pMsg, 
+				rMsg.GetTag(),
+				rMsg, 
 				dispatchID))
 			{
 				OnUnknownMessage(pMsg, dispatchID);
@@ -92,10 +100,10 @@ namespace holder::messages
 		virtual void OnNewClient(DispatchID clientID) { }
 		virtual void OnRemovingClient(DispatchID clientID) { }
 
-		virtual void OnUnknownMessage(const std::shared_ptr<IMessage> pMsg,
+		virtual void OnUnknownMessage(const std::shared_ptr<IMessage>& pMsg,
 			messages::DispatchID dispatchID) { }
 
-		virtual void OnUnknownClient(const std::shared_ptr<IMessage> pMsg,
+		virtual void OnUnknownClient(IMessage& rMsg,
 			messages::DispatchID dispatchID) { }
 
 		BaseMessageHandler(QueueID queueID)
@@ -161,27 +169,21 @@ namespace holder::messages
 
 		// For messages that can be dispatched to clients
 		template<typename MsgType>
-		void DispatchToClient(const std::shared_ptr<MsgType>& pMessage,
+		void DispatchToClient(MsgType& rMessage,
 			DispatchID dispatchID)
 		{
-			static_cast(std::is_base_of_v<IMessage, MsgType>,
+			static_assert(std::is_base_of_v<IMessage, MsgType>,
 				"MsgType must derive from IMessage");
 
-			auto itClient = m_clientMap.find(dispatchID);
-
-			if (itClient != m_clientMap.end())
-			{
-				pClient = &itClient->second;
-			}
+			Client* pClient = GetClient(dispatchID);
 
 			if (!pClient)
 			{
-				// Downcast
-				OnUnknownClient(pMessage, dispatchID);
+				OnUnknownClient(rMessage, dispatchID);
 				return;
 			}
 
-			pClient->OnMessage(pMessage);
+			pClient->OnMessage(rMessage);
 		}
 
 		QueueID GetQueueID() const
@@ -191,12 +193,12 @@ namespace holder::messages
 
 	private:
 		
-		static MessageDispatch<Derived>& GetMessageDispatchTable()
+		static MessageDispatch& GetMessageDispatchTable()
 		{
 			// The constructor of the dispatch calls a static function on the derived class
 			// to initialize the dispatch.  Since the construction of a static variable
 			// is atomic since x11, there is no data race here
-			static MessageDispatch<Derived> dispatch;
+			static MessageDispatch dispatch;
 			return dispatch;
 		}
 
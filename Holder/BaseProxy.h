@@ -67,10 +67,10 @@ namespace holder::service
 
 	private:
 
-		void OnServiceMessage(const std::shared_ptr<messages::IMessage>& pMessage,
+		void OnServiceMessage(messages::IMessage& rMessage,
 			messages::DispatchID dispatchID)
 		{
-			static_cast<IServiceMessage*>(pMessage.get())->Act(*this);
+			static_cast<IServiceMessage&>(rMessage).Act(*this);
 		}
 
 		std::shared_ptr<messages::ISenderEndpoint> m_pRemote;
@@ -94,6 +94,43 @@ bool impl_ns::BaseRequestHandler::ClientInfo::RemoveRequest(RequestID requestID)
 	return true;
 }
 
+bool impl_ns::BaseRequestHandler::ClientInfo::AddEarlyCancel(RequestID requestID)
+{
+	if (requestID < m_nextRequestID)
+	{
+		return false;
+	}
+
+	return m_earlyCancels.insert(requestID).second;
+}
+
+bool impl_ns::BaseRequestHandler::ClientInfo::TakeEarlyCancel(RequestID requestID)
+{
+	m_nextRequestID = requestID + 1;
+
+	if (m_earlyCancels.empty())
+	{
+		return false;
+	}
+
+	// Anything older belongs to an issue that never made it here
+	bool cancelled = false;
+	for (auto itCancel = m_earlyCancels.begin(); itCancel != m_earlyCancels.end(); )
+	{
+		if (*itCancel <= requestID)
+		{
+			cancelled = cancelled || *itCancel == requestID;
+			itCancel = m_earlyCancels.erase(itCancel);
+		}
+		else
+		{
+			++itCancel;
+		}
+	}
+
+	return cancelled;
+}
+
 // *BaseRequestHandler*
 bool impl_ns::BaseRequestHandler::ClientInfo::HasRequestID(RequestID requestID) const
 {
@@ -121,6 +158,14 @@ void impl_ns::BaseRequestHandler::CancelRequest(impl_ns::RequestID requestID,
 	if (pRequest)
 	{
 		pRequest->SetCancel();
+		return;
+	}
+
+	// Not here yet, or already finished
+	auto itClient = m_requestClients.find(clientID);
+	if (itClient != m_requestClients.end())
+	{
+		itClient->second.AddEarlyCancel(requestID);
 	}
 }
 
@@ -175,6 +220,21 @@ void impl_ns::BaseRequestHandler::OnRequestOutgoingMessage(holder::messages::IMe
 	static_cast<IRequestOutgoingMessage&>(msg).Act(*this, clientID);
 }
 
+void impl_ns::BaseRequestHandler::AcknowledgeEarlyCancel(ClientInfo& client, RequestID requestID)
+{
+	auto pRemoteEndpoint = client.GetRemoteEndpoint();
+	if (!pRemoteEndpoint)
+	{
+		return;
+	}
+
+	using DeltaCancelAck = RequestSetStateDelta<RequestState::CancelAcknowledged>;
+	auto pCancelAck = std::make_shared<RequestStateUpdate<DeltaCancelAck> >(requestID,
+		DeltaCancelAck());
+
+	pRemoteEndpoint->SendMessage(std::move(pCancelAck));
+}
+
 impl_ns::BaseHandlerRequestInfo* impl_ns::BaseRequestHandler::GetRequestInfo(HandlerRequestInfoID requestInfoID)
 {
 	auto itRequestInfo = m_requestInfos.find(requestInfoID);
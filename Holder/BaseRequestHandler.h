@@ -5,6 +5,7 @@
 #include "MessageLib.h"
 
 #include <unordered_map>
+#include <unordered_set>
 #include <type_traits>
 
 namespace holder::reqresp
@@ -121,6 +122,13 @@ namespace holder::reqresp
 
 			bool HasRequestID(RequestID requestID) const;
 
+			// Issues from a client arrive in the order they were made, but a cancel goes in
+			// a faster lane and can get here before the issue it cancels.  Such a cancel is
+			// held until its issue arrives; one for a request already seen is stale
+			bool AddEarlyCancel(RequestID requestID);
+			// Called as each issue arrives; true if it was cancelled on the way
+			bool TakeEarlyCancel(RequestID requestID);
+
 			HandlerRequestInfoID GetRequestInfoID(RequestID requestID) const;
 
 			const std::shared_ptr<messages::ISenderEndpoint>
@@ -155,6 +163,9 @@ namespace holder::reqresp
 		private:
 			std::unordered_map<RequestID,
 				HandlerRequestInfoID> m_requestMap;
+			// One past the latest issue seen
+			RequestID m_nextRequestID{ 0 };
+			std::unordered_set<RequestID> m_earlyCancels;
 			// Other information
 			std::shared_ptr<messages::ISenderEndpoint>
 				m_pRemoteEndpoint;
@@ -203,6 +214,12 @@ namespace holder::reqresp
 				return reqID;
 			}
 
+			if (itClient->second.TakeEarlyCancel(requestID))
+			{
+				AcknowledgeEarlyCancel(itClient->second, requestID);
+				return reqID;
+			}
+
 			HandlerRequestInfoID internalID = m_freeID++;
 
 			// Client found.  Create the request
@@ -238,6 +255,9 @@ namespace holder::reqresp
 
 		BaseHandlerRequestInfo* GetRequestInfo(HandlerRequestInfoID requestInfoID);
 
+		// The request is never created, but the client still expects to hear about it
+		void AcknowledgeEarlyCancel(ClientInfo& client, RequestID requestID);
+
 		HandlerRequestInfoID GetRequestInfoID(messages::DispatchID clientID,
 			RequestID requestID) const
 		{
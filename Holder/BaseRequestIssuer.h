@@ -177,9 +177,11 @@ namespace holder::reqresp
 
 				if (pLocalEndpoint)
 				{
-					// Set an anonymous timeout timer
+					// Set an anonymous timeout timer.  It may fire up to a tenth of the timeout late,
+					// so that timeouts set close together share a wakeup
 					base::ExecutionManager::GetInstance().SetTimer("", timeout, false, 0,
-						std::make_shared<TimeoutSender>(pLocalEndpoint, newRequestID));
+						std::make_shared<TimeoutSender>(pLocalEndpoint, newRequestID),
+						base::EXEC_WILDCARD, timeout / 10);
 				}
 			}
 
@@ -83,6 +83,13 @@ namespace holder::reqresp
 			:RequestOutgoingMessage(requestID)
 		{ }
 
+		// Cancels should not queue up behind the work they are cancelling.  One that overtakes
+		// its issue is held by the handler until the issue arrives
+		messages::MessagePriority GetPriority() const override
+		{
+			return messages::PRIORITY_HIGH;
+		}
+
 		void Act(IRequestHandler& reqHandler, messages::DispatchID clientID) override
 		{
 			reqHandler.CancelRequest(GetRequestID(), clientID);
@@ -108,6 +115,15 @@ namespace holder::reqresp
 			m_requestDelta(reqInfo);
 		}
 
+		// Every update for a request, whatever its delta, travels in the same lane, so that they
+		// are applied in the order they were sent: a timeout must not overtake the completion
+		// it lost the race to, nor a cancel acknowledgement an earlier completion.  High, so
+		// that cancellations and timeouts still get ahead of bulk traffic
+		messages::MessagePriority GetPriority() const override
+		{
+			return messages::PRIORITY_HIGH;
+		}
+
 	private:
 		RequestDelta m_requestDelta;
 	};
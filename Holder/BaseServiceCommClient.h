@@ -94,9 +94,11 @@ namespace holder::scomm
 
 			if (timeout != 0)
 			{
-				// Set an anonymous one-shot timer with a cancel message on timeout
+				// Set an anonymous one-shot timer with a cancel message on timeout.  It may fire
+				// up to a tenth of the timeout late, so that timeouts share wakeups
 				base::ExecutionManager::GetInstance().SetTimer("", timeout, false, 0,
-					std::make_shared<TimeoutSender>(pRemoteEndpoint, reqID));
+					std::make_shared<TimeoutSender>(pRemoteEndpoint, reqID),
+					base::EXEC_WILDCARD, timeout / 10);
 			}
 
 			outIDs.requestID = reqID;
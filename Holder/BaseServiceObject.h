@@ -88,9 +88,9 @@ namespace holder::service
 				m_pEndpoint = queueManager.CreateEndpoint(remoteQueueID, remoteReceiverID);
 			}
 
-			void OnMessage(const std::shared_ptr<IServiceMessage>& pServiceMessage)
+			void OnMessage(IServiceMessage& rServiceMessage)
 			{
-				pServiceMessage->Act(*this);
+				rServiceMessage.Act(*this);
 			}
 			messages::ReceiverID GetReceiverID() const
 			{
@@ -110,17 +110,13 @@ namespace holder::service
 		};
 
 	public:
-		void OnServiceMessage(const std::shared_ptr<messages::IMessage>& pMsg,
+		void OnServiceMessage(messages::IMessage& rMsg,
 			messages::DispatchID dispatchID)
 		{
-			// TODO:  Is there a way to do this without constructing a new shared_ptr?
-			auto pServiceMessage
-				= std::static_pointer_cast<IServiceMessage>(pMsg);
-
-			BaseType::DispatchToClient<IServiceMessage>(pServiceMessage, dispatchID);
+			BaseType::DispatchToClient(static_cast<IServiceMessage&>(rMsg), dispatchID);
 		}
 
-		void OnDestroyMessage(const std::shared_ptr<messages::IMessage>& pMsg,
+		void OnDestroyMessage(messages::IMessage& rMsg,
 			messages::DispatchID dispatchID)
 		{
 			BaseType::RemoveClient(dispatchID);
@@ -166,7 +162,8 @@ namespace holder::service
 			auto proxyFuture = pCreateProxyMessage->GetFuture();
 
 			queueManager.SendMessage(BaseType::GetQueueID(), 
-				BaseType::GetDefaultReceiverID());
+				BaseType::GetDefaultReceiverID(),
+				pCreateProxyMessage);
 
 			proxyFuture.wait();
 
@@ -439,7 +439,7 @@ namespace holder::data
 			return childResult;
 		}
 
-		auto valResult = GetValue(pEl, value);
+		auto valResult = GetValue(*pEl, value);
 		return valResult;
 	}
 
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+namespace holder::lib
+{
+
+	// Lets a thread sleep until "something happened" without a periodic wakeup, and without
+	// notifiers paying for a lock when nobody sleeps.
+	// The waiter announces itself with PrepareWait, checks its condition again, and then
+	// either calls CancelWait or Wait.  A notifier makes the condition true first and then
+	// calls Notify.  Both sides touch m_state in sequentially consistent order, so either
+	// the waiter sees the condition or the notifier sees the waiter
+	class EventCount
+	{
+	private:
+		static constexpr uint64_t WAITER_MASK = 0xffffffff;
+		static constexpr uint64_t EPOCH_SHIFT = 32;
+		static constexpr uint64_t EPOCH_INC = uint64_t(1) << EPOCH_SHIFT;
+
+	public:
+		using Key = uint32_t;
+
+		Key PrepareWait()
+		{
+			return static_cast<Key>(m_state.fetch_add(1) >> EPOCH_SHIFT);
+		}
+
+		void CancelWait()
+		{
+			m_state.fetch_sub(1);
+		}
+
+		// Returns once a Notify has happened since PrepareWait returned the key
+		void Wait(Key key)
+		{
+			{
+				std::unique_lock lk{ m_mutex };
+				while (static_cast<Key>(m_state.load() >> EPOCH_SHIFT) == key)
+				{
+					m_cv.wait(lk);
+				}
+			}
+			m_state.fetch_sub(1);
+		}
+
+		// Wakes every waiter; there is normally only one
+		void Notify()
+		{
+			if ((m_state.load() & WAITER_MASK) == 0)
+			{
+				return;
+			}
+
+			{
+				// The epoch moves under the mutex, so a waiter cannot miss it between its
+				// check and its wait
+				std::unique_lock lk{ m_mutex };
+				m_state.fetch_add(EPOCH_INC);
+			}
+			m_cv.notify_all();
+		}
+
+	private:
+		// Epoch in the high half, number of waiters in the low half
+		std::atomic<uint64_t> m_state{ 0 };
+		std::mutex m_mutex;
+		std::condition_variable m_cv;
+	};
+
+}
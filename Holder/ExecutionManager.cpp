@@ -1,26 +1,244 @@
 #include "ExecutionManager.h"
 #include "SingletonConfig.h"
 
+#include <algorithm>
 #include <iostream>
 
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <fstream>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 namespace impl_ns = holder::base;
 
+namespace
+{
+	// Room for this many executors and instructions is allocated by the thread itself, so
+	// that it comes from the thread's node
+	constexpr size_t INITIAL_THREAD_CAPACITY = 64;
+
+	// Spinning threads look at the clock once per this many pauses
+	constexpr size_t SPIN_CHECK_INTERVAL = 64;
+
+	// Resolution of the timer wheel
+	constexpr std::chrono::microseconds TIMER_TICK{ 1000 };
+
+	// For counters with a single writer
+	void BumpCounter(std::atomic<uint64_t>& rCounter, uint64_t count = 1)
+	{
+		rCounter.store(rCounter.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+	}
+
+	size_t TimerHistogramBucket(std::chrono::steady_clock::duration elapsed)
+	{
+		auto elapsedUs = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+
+		size_t bucket{ 0 };
+		while (bucket < holder::base::TimerStats::HISTOGRAM_BUCKETS - 1
+			&& elapsedUs >= (int64_t(1) << bucket))
+		{
+			++bucket;
+		}
+		return bucket;
+	}
+
+	// Index of the lowest set bit; bits must not be zero
+	inline unsigned LowestBit(uint64_t bits)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward64(&index, bits);
+		return static_cast<unsigned>(index);
+#else
+		return static_cast<unsigned>(__builtin_ctzll(bits));
+#endif
+	}
+
+	// Index of the highest set bit; bits must not be zero
+	inline unsigned HighestBit(uint64_t bits)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanReverse64(&index, bits);
+		return static_cast<unsigned>(index);
+#else
+		return 63 - static_cast<unsigned>(__builtin_clzll(bits));
+#endif
+	}
+
+	// Distance from "from" to the first set bit at or cyclically after it, or -1 if no
+	// bit is set
+	template<size_t words>
+	int NextSetBit(const uint64_t (&bitmap)[words], size_t from)
+	{
+		constexpr size_t bitCount = words * 64;
+		size_t fromWord = from / 64;
+		uint64_t fromMask = ~uint64_t(0) << (from % 64);
+
+		for (size_t i = 0; i <= words; ++i)
+		{
+			size_t word = (fromWord + i) % words;
+			uint64_t bits = bitmap[word];
+			if (i == 0)
+			{
+				bits &= fromMask;
+			}
+			else if (i == words)
+			{
+				// Back at the first word: only the part before "from" is left
+				bits &= ~fromMask;
+			}
+
+			if (bits != 0)
+			{
+				size_t index = word * 64 + LowestBit(bits);
+				return static_cast<int>((index + bitCount - from) % bitCount);
+			}
+		}
+		return -1;
+	}
+
+	// Tells the core we are spinning: frees resources for the sibling hyperthread and
+	// avoids the memory-order flush on the way out of the loop
+	inline void CpuRelax()
+	{
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+		_mm_pause();
+#elif defined(__aarch64__)
+		asm volatile("yield");
+#endif
+	}
+
+#ifdef __linux__
+	// Parses a kernel CPU list such as "0-3,8,10-11"
+	std::vector<unsigned int> GetNodeCpus(int numaNode)
+	{
+		std::vector<unsigned int> cpus;
+		std::ifstream cpuList("/sys/devices/system/node/node" + std::to_string(numaNode) + "/cpulist");
+		std::string range;
+
+		while (std::getline(cpuList, range, ','))
+		{
+			size_t dashPos = range.find('-');
+			try
+			{
+				unsigned long first = std::stoul(range.substr(0, dashPos));
+				unsigned long last = dashPos == std::string::npos ? first : std::stoul(range.substr(dashPos + 1));
+				for (unsigned long cpu = first; cpu <= last; ++cpu)
+				{
+					cpus.push_back(static_cast<unsigned int>(cpu));
+				}
+			}
+			catch (const std::exception&)
+			{
+				return std::vector<unsigned int>();
+			}
+		}
+		return cpus;
+	}
+#endif
+
+	void PlaceCurrentThread(const std::string& threadName, const holder::base::ExecutorThreadOptions& options)
+	{
+#ifdef __linux__
+		std::vector<unsigned int> cpus = !options.cpuSet.empty() ? options.cpuSet : GetNodeCpus(options.numaNode);
+
+		cpu_set_t cpuSet;
+		CPU_ZERO(&cpuSet);
+		for (unsigned int cpu : cpus)
+		{
+			if (cpu < CPU_SETSIZE)
+			{
+				CPU_SET(cpu, &cpuSet);
+			}
+		}
+
+		if (CPU_COUNT(&cpuSet) == 0
+			|| pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) != 0)
+		{
+			std::cerr << "Could not place executor thread " << threadName << "; it runs unpinned\n";
+		}
+#else
+		std::cerr << "Thread placement is not supported on this platform; " << threadName << " runs unpinned\n";
+#endif
+	}
+}
+
+struct impl_ns::ExecutorSignalSlot
+{
+	static constexpr uint32_t WAKE_UP = 1;
+	static constexpr uint32_t TERMINATE = 2;
+	// Set by the thread once the executor is gone.  Since pending is never zero again,
+	// the slot is never queued again
+	static constexpr uint32_t REMOVED = 4;
+
+	explicit ExecutorSignalSlot(ExecutionManager::ExecutorThread* pThread_)
+		:pThread(pThread_)
+	{ }
+
+	// Nonzero while the slot is on the thread's signalled list
+	std::atomic<uint32_t> pending{ 0 };
+	ExecutorSignalSlot* pNext{ nullptr };
+	// Threads live as long as the manager
+	ExecutionManager::ExecutorThread* pThread;
+
+	// Owned by the thread
+	size_t execIndex{ 0 };
+	bool registered{ false };
+	// Taken off the list before the executor was added; AddExecutor delivers it
+	bool poppedEarly{ false };
+};
+
 void impl_ns::ExecutionManager::ExecutorThread::operator()(
 	ExecutorID firstExecId,
-	std::shared_ptr<IExecutor> pFirstExecutor)
+	std::shared_ptr<IExecutor> pFirstExecutor,
+	std::shared_ptr<ExecutorSignalSlot> pFirstSlot)
 {
 	// Set the thread local variable giving the thread name
 	ExecutionManager::m_tlThreadName = m_threadName;
 
+	// Pin first, so that everything allocated below is local to where the thread runs
+	if (m_options.HasPlacement())
+	{
+		PlaceCurrentThread(m_threadName, m_options);
+	}
+
+	if (m_options.spinBudget.count() > 0 && std::thread::hardware_concurrency() == 1)
+	{
+		// Whoever would post the work could not run while we spin
+		std::cerr << "Executor thread " << m_threadName << " does not spin on a single CPU\n";
+		m_options.spinBudget = std::chrono::microseconds(0);
+	}
+
+	std::vector<ExecutionInstructionMessage> localInstructionList;
+
+	m_executors.reserve(INITIAL_THREAD_CAPACITY);
+	m_readyList.reserve(INITIAL_THREAD_CAPACITY);
+	m_runList.reserve(INITIAL_THREAD_CAPACITY);
+	m_execsToRemove.reserve(INITIAL_THREAD_CAPACITY);
+	m_signalMap.reserve(INITIAL_THREAD_CAPACITY);
+	localInstructionList.reserve(INITIAL_THREAD_CAPACITY);
+	{
+		std::unique_lock lk{ m_mutexInstructions };
+		m_instructionList.reserve(INITIAL_THREAD_CAPACITY);
+	}
+
 	// Add the initial executor
-	AddExecutor(firstExecId, pFirstExecutor);
+	AddExecutor(firstExecId, pFirstExecutor, pFirstSlot);
 
 	// Begin the loop
 	bool shouldRun{ !m_executors.empty() };
 	bool justWaited{ false };
 
-	std::vector<ExecutionInstructionMessage> localInstructionList;
-
 	while (shouldRun)
 	{
 		bool expNI{ true };
@@ -40,7 +258,7 @@ void impl_ns::ExecutionManager::ExecutorThread::operator()(
 			{
 				if (msg.instructionTag == ExecutionInstructionTag::AddExecutor)
 				{
-					AddExecutor(msg.execId, msg.executor);
+					AddExecutor(msg.execId, msg.executor, msg.pSlot);
 				}
 			}
 
@@ -50,55 +268,59 @@ void impl_ns::ExecutionManager::ExecutorThread::operator()(
 				{
 					HandleExecutorSignal(msg.execId, msg.signalType);
 				}
+				else if (msg.instructionTag == ExecutionInstructionTag::DeliverTimers)
+				{
+					HandleExpiredTimers(msg.execId, msg.expiredTimers);
+				}
 			}
 		}
 
-		// Now go through the active executors round-robin and call them
-		std::vector<ExecutorID> execsToRemove;
-		for (ExecutorState& execState : m_executors)
+		// After the adds, so that a slot is seldom seen before its executor
+		if (m_signalledSlots.load(std::memory_order_relaxed))
 		{
-			if (execState.stateTag == ExecutorStateTag::Executing)
-			{
-				ExecutionArgs execArgs;
-				ExecutionState nextState = execState.pExecutor->Run(execArgs);
-
-				if (nextState == ExecutionState::Suspend)
-				{
-					// Set the tag to "suspended" and decrease the number of active
-					// executors
-					execState.stateTag = ExecutorStateTag::Suspended;
-					--m_nActive;
-				}
-				else if (nextState == ExecutionState::End)
-				{
-					execsToRemove.emplace_back(execState.execId);
-				}
-			}
+			HandleSlotSignals();
 		}
 
+		// Now go through the active executors round-robin and call them
+		RunReady();
+
 		// Remove any executors that asked to be removed
-		if (!execsToRemove.empty())
+		if (!m_execsToRemove.empty())
 		{
-			for (ExecutorID idToRemove : execsToRemove)
+			for (ExecutorID idToRemove : m_execsToRemove)
 			{
 				RemoveExecutor(idToRemove);
 			}
-			ExecutionManager::GetInstance().RemoveExecutors(execsToRemove);
+			ExecutionManager::GetInstance().RemoveExecutors(m_execsToRemove);
+			m_execsToRemove.clear();
 		}
 
-		// If the number of active executors is 0, go to sleep
-		if (m_nActive == 0)
+		// If there are no active executors, go to sleep
+		if (m_readyList.empty())
 		{
-			// Wait / sleep with a periodic wakeup
-			std::unique_lock lk{ m_mutexInstructions };
-			shouldRun = !m_instructionList.empty() || !m_executors.empty() || !m_isDoomed;
-			
-			// shouldRun false means the thread is doomed, has no executors and its instruction list is empty
-			// in effect, 
-			if (shouldRun)
+			if (m_options.spinBudget.count() > 0 && SpinForWork())
+			{
+				continue;
+			}
+
+			// Announce the wait before looking, so that a post after the look wakes us
+			lib::EventCount::Key waitKey = m_eventCount.PrepareWait();
+			bool mustWait{ false };
 			{
-				m_cvInstructions.wait_for(lk, ExecutionManager::GetInstance().GetIdleTimeout());
+				std::unique_lock lk{ m_mutexInstructions };
 				shouldRun = !m_instructionList.empty() || !m_executors.empty() || !m_isDoomed;
+
+				// shouldRun false means the thread is doomed, has no executors and its instruction list is empty
+				mustWait = shouldRun && m_instructionList.empty() && !m_signalledSlots.load();
+			}
+
+			if (mustWait)
+			{
+				m_eventCount.Wait(waitKey);
+			}
+			else
+			{
+				m_eventCount.CancelWait();
 			}
 
 			justWaited = true;
@@ -113,18 +335,159 @@ void impl_ns::ExecutionManager::ExecutorThread::operator()(
 }
 
 void impl_ns::ExecutionManager::ExecutorThread::AddExecutor(ExecutorID execId,
-	std::shared_ptr<IExecutor> pExecutor)
+	std::shared_ptr<IExecutor> pExecutor,
+	std::shared_ptr<ExecutorSignalSlot> pSlot)
 {
 	if (!pExecutor->Init())
 	{
+		if (pSlot->pending.fetch_or(ExecutorSignalSlot::REMOVED) != 0
+			&& !pSlot->poppedEarly)
+		{
+			m_retiredSlots.emplace_back(std::move(pSlot));
+		}
 		return;
 	}
 
 	size_t localId = m_executors.size();
-	m_executors.emplace_back(execId, ExecutorStateTag::Executing, pExecutor);
+	m_executors.emplace_back(execId, ExecutorStateTag::Executing, pExecutor, pSlot);
 	m_signalMap.emplace(execId, localId);
-	++m_nActive;
+	MakeReady(localId);
+
+	pSlot->execIndex = localId;
+	pSlot->registered = true;
+	if (pSlot->poppedEarly)
+	{
+		// Already executing, so only a termination request matters
+		pSlot->poppedEarly = false;
+		if (pSlot->pending.exchange(0) & ExecutorSignalSlot::TERMINATE)
+		{
+			HandleSignalForIndex(localId, ExecutorSignalType::RequestTermination);
+		}
+	}
+}
+
+void impl_ns::ExecutionManager::ExecutorThread::HandleSlotSignals()
+{
+	ExecutorSignalSlot* pSlot = m_signalledSlots.exchange(nullptr);
+
+	while (pSlot)
+	{
+		// Once pending is cleared the slot can be queued again, and pNext with it
+		ExecutorSignalSlot* pNext = pSlot->pNext;
+
+		if (pSlot->pending.load() & ExecutorSignalSlot::REMOVED)
+		{
+			auto itRetired = std::find_if(m_retiredSlots.begin(), m_retiredSlots.end(),
+				[pSlot](const std::shared_ptr<ExecutorSignalSlot>& pRetired)
+				{
+					return pRetired.get() == pSlot;
+				});
+
+			if (itRetired != m_retiredSlots.end())
+			{
+				std::swap(*itRetired, m_retiredSlots.back());
+				m_retiredSlots.pop_back();
+			}
+		}
+		else if (!pSlot->registered)
+		{
+			pSlot->poppedEarly = true;
+		}
+		else
+		{
+			uint32_t signals = pSlot->pending.exchange(0);
+			HandleSignalForIndex(pSlot->execIndex, 
+				(signals & ExecutorSignalSlot::TERMINATE) ? ExecutorSignalType::RequestTermination
+					: ExecutorSignalType::WakeUp);
+		}
+
+		pSlot = pNext;
+	}
+}
 
+void impl_ns::ExecutionManager::ExecutorThread::PostSlotSignal(ExecutorSignalSlot& rSlot,
+	ExecutorSignalType signalType)
+{
+	uint32_t signal = signalType == ExecutorSignalType::RequestTermination
+		? ExecutorSignalSlot::TERMINATE : ExecutorSignalSlot::WAKE_UP;
+
+	if (rSlot.pending.fetch_or(signal) != 0)
+	{
+		// Queued already, or the executor is gone
+		return;
+	}
+
+	ExecutorSignalSlot* pHead = m_signalledSlots.load();
+	do
+	{
+		rSlot.pNext = pHead;
+	} while (!m_signalledSlots.compare_exchange_weak(pHead, &rSlot));
+
+	m_eventCount.Notify();
+}
+
+void impl_ns::ExecutionManager::ExecutorThread::MakeReady(size_t execIndex)
+{
+	auto& rExec = m_executors[execIndex];
+
+	rExec.stateTag = ExecutorStateTag::Executing;
+	rExec.readyPos = m_readyList.size();
+	m_readyList.emplace_back(execIndex);
+}
+
+bool impl_ns::ExecutionManager::ExecutorThread::SpinForWork()
+{
+	auto spinDeadline = std::chrono::steady_clock::now() + m_options.spinBudget;
+
+	while (true)
+	{
+		for (size_t spinIdx = 0; spinIdx < SPIN_CHECK_INTERVAL; ++spinIdx)
+		{
+			// The loop top takes these with a full fence
+			if (m_newInstructions.load(std::memory_order_relaxed)
+				|| m_signalledSlots.load(std::memory_order_relaxed))
+			{
+				return true;
+			}
+			CpuRelax();
+		}
+
+		if (std::chrono::steady_clock::now() >= spinDeadline)
+		{
+			return false;
+		}
+	}
+}
+
+void impl_ns::ExecutionManager::ExecutorThread::RunReady()
+{
+	// Executors that continue, or are woken by an executor on this pass, go onto the 
+	// (now empty) ready list for the next one
+	std::swap(m_runList, m_readyList);
+
+	for (size_t execIndex : m_runList)
+	{
+		auto& rExec = m_executors[execIndex];
+
+		ExecutionArgs execArgs;
+		ExecutionState nextState = rExec.pExecutor->Run(execArgs);
+
+		if (nextState == ExecutionState::Continue)
+		{
+			MakeReady(execIndex);
+		}
+		else if (nextState == ExecutionState::Suspend)
+		{
+			rExec.stateTag = ExecutorStateTag::Suspended;
+		}
+		else
+		{
+			// Stays "executing" so that signals do not put it back on the ready list
+			m_execsToRemove.emplace_back(rExec.execId);
+		}
+	}
+
+	m_runList.clear();
 }
 
 void impl_ns::ExecutionManager::ExecutorThread::HandleSignalForIndex(size_t execIndex, ExecutorSignalType signalType)
@@ -138,8 +501,7 @@ void impl_ns::ExecutionManager::ExecutorThread::HandleSignalForIndex(size_t exec
 	// Every signal is also a wakeup
 	if (rExec.stateTag == ExecutorStateTag::Suspended)
 	{
-		++m_nActive;
-		rExec.stateTag = ExecutorStateTag::Executing;
+		MakeReady(execIndex);
 	}
 }
 
@@ -163,6 +525,24 @@ void impl_ns::ExecutionManager::ExecutorThread::HandleExecutorSignal(ExecutorID
 	}
 }
 
+void impl_ns::ExecutionManager::ExecutorThread::HandleExpiredTimers(ExecutorID execId,
+	const std::vector<ExpiredTimer>& expiredTimers)
+{
+	auto itExec = m_signalMap.find(execId);
+
+	if (itExec == m_signalMap.end())
+	{
+		// Gone; its timers go with it
+		return;
+	}
+
+	for (const ExpiredTimer& expired : expiredTimers)
+	{
+		expired.pCallback->OnTimer(expired.timerUserID, expired.timerID);
+	}
+	HandleSignalForIndex(itExec->second, ExecutorSignalType::WakeUp);
+}
+
 // Remove an executor from the array
 void impl_ns::ExecutionManager::ExecutorThread::RemoveExecutor(ExecutorID execId)
 {
@@ -175,6 +555,12 @@ void impl_ns::ExecutionManager::ExecutorThread::RemoveExecutor(ExecutorID execId
 
 		rExec.pExecutor->DeInit();
 
+		// If the slot is queued (or about to be), keep it alive until it comes off the list
+		if (rExec.pSlot->pending.fetch_or(ExecutorSignalSlot::REMOVED) != 0)
+		{
+			m_retiredSlots.emplace_back(std::move(rExec.pSlot));
+		}
+
 		size_t lastIdx = m_executors.size() - 1;
 		if (execIdx != lastIdx)
 		{
@@ -182,31 +568,43 @@ void impl_ns::ExecutionManager::ExecutorThread::RemoveExecutor(ExecutorID execId
 			auto& rOtherExec = m_executors[lastIdx];
 
 			// Here it's perfectly valid to use [] since the execID is guaranteed to be
-			// in the map
+			// in the map.  After the swap rExec is the one that moved
 			std::swap(rOtherExec, rExec);
-			m_signalMap[rOtherExec.execId] = execIdx;
+			m_signalMap[rExec.execId] = execIdx;
+			rExec.pSlot->execIndex = execIdx;
+
+			// Removal happens between passes, so a moved executor that is ready
+			// is on m_readyList
+			if (rExec.stateTag == ExecutorStateTag::Executing
+				&& rExec.readyPos < m_readyList.size()
+				&& m_readyList[rExec.readyPos] == lastIdx)
+			{
+				m_readyList[rExec.readyPos] = execIdx;
+			}
 		}
 
 		m_signalMap.erase(execId);
-		// An executor must be active in order to signal that it has ended
-		// Thus its removal always decreases the active count
-		--m_nActive;
 		// The executor in question is just the last entry in the array
 		m_executors.pop_back();
 	}
 }
 
 void impl_ns::ExecutionManager::ExecutorThread::PostAddExecutor(ExecutorID execId,
-	std::shared_ptr<IExecutor> pExecutor)
+	std::shared_ptr<IExecutor> pExecutor,
+	std::shared_ptr<ExecutorSignalSlot> pSlot)
 {
 	ExecutionInstructionMessage execInstruction;
 	execInstruction.execId = execId;
 	execInstruction.executor = pExecutor;
+	execInstruction.pSlot = pSlot;
 	execInstruction.instructionTag = ExecutionInstructionTag::AddExecutor;
 
-	std::unique_lock lk{ m_mutexInstructions };
-	m_instructionList.emplace_back(execInstruction);
-	m_cvInstructions.notify_one();
+	{
+		std::unique_lock lk{ m_mutexInstructions };
+		m_instructionList.emplace_back(execInstruction);
+		m_newInstructions.store(true);
+	}
+	m_eventCount.Notify();
 
 }
 void impl_ns::ExecutionManager::ExecutorThread::PostSignalExecutor(ExecutorID execId,
@@ -217,9 +615,28 @@ void impl_ns::ExecutionManager::ExecutorThread::PostSignalExecutor(ExecutorID ex
 	execInstruction.instructionTag = ExecutionInstructionTag::SignalExecutor;
 	execInstruction.signalType = signalType;
 
-	std::unique_lock lk{ m_mutexInstructions };
-	m_instructionList.emplace_back(execInstruction);
-	m_cvInstructions.notify_one();
+	{
+		std::unique_lock lk{ m_mutexInstructions };
+		m_instructionList.emplace_back(execInstruction);
+		m_newInstructions.store(true);
+	}
+	m_eventCount.Notify();
+}
+
+void impl_ns::ExecutionManager::ExecutorThread::PostTimers(ExecutorID execId,
+	std::vector<ExpiredTimer>&& expiredTimers)
+{
+	ExecutionInstructionMessage execInstruction;
+	execInstruction.execId = execId;
+	execInstruction.instructionTag = ExecutionInstructionTag::DeliverTimers;
+	execInstruction.expiredTimers = std::move(expiredTimers);
+
+	{
+		std::unique_lock lk{ m_mutexInstructions };
+		m_instructionList.emplace_back(std::move(execInstruction));
+		m_newInstructions.store(true);
+	}
+	m_eventCount.Notify();
 }
 
 void impl_ns::ExecutionManager::ExecutorThread::PostSignalAll(ExecutorSignalType signalType)
@@ -229,32 +646,42 @@ void impl_ns::ExecutionManager::ExecutorThread::PostSignalAll(ExecutorSignalType
 	execInstruction.instructionTag = ExecutionInstructionTag::SignalExecutor;
 	execInstruction.signalType = signalType;
 
-	std::unique_lock lk{ m_mutexInstructions };
-	m_instructionList.emplace_back(execInstruction);
-	m_cvInstructions.notify_one();
+	{
+		std::unique_lock lk{ m_mutexInstructions };
+		m_instructionList.emplace_back(execInstruction);
+		m_newInstructions.store(true);
+	}
+	m_eventCount.Notify();
 }
 
 void impl_ns::ExecutionManager::ExecutorThread::DoomMe()
 {
-	std::unique_lock lk{ m_mutexInstructions };
-	m_isDoomed = true;
+	{
+		std::unique_lock lk{ m_mutexInstructions };
+		m_isDoomed = true;
+	}
+	m_eventCount.Notify();
 }
 
 impl_ns::ExecutionManager::ExecutorThread::ExecutorThread(ThreadID id,
 	const std::string& threadName,
-	bool isSingleton)
+	bool isSingleton,
+	const ExecutorThreadOptions& options)
 	:m_threadId(id),
 	m_threadName(threadName),
-	m_isSingleton(isSingleton)
+	m_isSingleton(isSingleton),
+	m_options(options)
 {
 
 }
 
 
 void impl_ns::ExecutionManager::ExecutorThread::StartMe(ExecutorID execId,
-	std::shared_ptr<IExecutor> pFirstExecutor)
+	std::shared_ptr<IExecutor> pFirstExecutor,
+	std::shared_ptr<ExecutorSignalSlot> pFirstSlot)
 {
-	m_thread = std::thread(&ExecutionManager::ExecutorThread::operator(), this, execId, pFirstExecutor);
+	m_thread = std::thread(&ExecutionManager::ExecutorThread::operator(), this, execId, pFirstExecutor,
+		pFirstSlot);
 }
 
 
@@ -267,6 +694,7 @@ void impl_ns::ExecutionManager::ExecutorThread::JoinMe()
 
 // TimerThread
 impl_ns::ExecutionManager::TimerThread::TimerThread()
+	:m_wheelStart(std::chrono::steady_clock::now())
 {
 }
 
@@ -276,7 +704,11 @@ void impl_ns::ExecutionManager::TimerThread::StartMe()
 }
 void impl_ns::ExecutionManager::TimerThread::DoomMe()
 {
-	m_threadDoomed.store(true);
+	{
+		std::unique_lock lk(m_mutexInstructions);
+		m_threadDoomed.store(true);
+	}
+	m_cvInstructions.notify_one();
 }
 void impl_ns::ExecutionManager::TimerThread::JoinMe()
 {
@@ -287,7 +719,9 @@ void impl_ns::ExecutionManager::TimerThread::SetTimer(const char* pTimerName,
 	unsigned long microInterval,
 	bool repeatingTimer,
 	TimerUserID timerUserID,
-	std::shared_ptr<ITimerCallback> pCallback)
+	std::shared_ptr<ITimerCallback> pCallback,
+	ExecutorID ownerExecutor,
+	unsigned long microSlack)
 {
 	// Convert the duration from microseconds to the system specific steady clock
 	std::chrono::microseconds usInterval{ microInterval };
@@ -302,6 +736,9 @@ void impl_ns::ExecutionManager::TimerThread::SetTimer(const char* pTimerName,
 	timerMsg.timerDef.repeatingTimer = repeatingTimer;
 	timerMsg.timerDef.timerUserID = timerUserID;
 	timerMsg.timerDef.pCallback = std::move(pCallback);
+	timerMsg.timerDef.ownerExecutor = ownerExecutor;
+	timerMsg.timerDef.slack =
+		std::chrono::duration_cast<typename std::chrono::steady_clock::duration>(std::chrono::microseconds{ microSlack });
 
 	std::unique_lock lk(m_mutexInstructions);
 	m_messages.push_back(std::move(timerMsg));
@@ -335,6 +772,7 @@ void impl_ns::ExecutionManager::TimerThread::CancelTimer(TimerID timerID)
 void impl_ns::ExecutionManager::TimerThread::operator()()
 {
 	std::deque<TimerMessage> msgs;
+	auto hasInstructions = [this] { return !m_messages.empty() || m_threadDoomed.load(); };
 
 	while (!m_threadDoomed.load())
 	{
@@ -349,158 +787,714 @@ void impl_ns::ExecutionManager::TimerThread::operator()()
 			msgs.pop_front();
 		}
 
-		// Process exactly one message
-		if (!m_timerPriorities.empty())
-		{
-			TimerPriorityEntry topTimer = m_timerPriorities.top();
-
-			// Get the current time 
-			std::chrono::time_point<std::chrono::steady_clock> curTime = std::chrono::steady_clock::now();
+		AdvanceTo(TickOf(std::chrono::steady_clock::now()));
+		FireDueTimers();
 
-			if (curTime >= topTimer.nextBeat)
-			{
-				auto timerAction = OnTimerDue(topTimer);
+		m_activeTimers.store(m_timerStates.size(), std::memory_order_relaxed);
+		m_publishedSlotsInUse.store(m_slotsInUse, std::memory_order_relaxed);
 
-				m_timerPriorities.pop();
+		// Sleep until the wheel has something to do
+		uint64_t nextTick = NextEventTick();
 
-				if (timerAction == TimerAction::Reinsert)
-				{
-					m_timerPriorities.push(topTimer);
-				}
-			}
-			else
-			{
-				std::unique_lock lk(m_mutexInstructions);
-				m_cvInstructions.wait_until(lk, topTimer.nextBeat);
-			}
+		std::unique_lock lk(m_mutexInstructions);
+		if (nextTick == NO_TICK)
+		{
+			m_cvInstructions.wait(lk, hasInstructions);
 		}
 		else
 		{
-			// No timers -- wait for events
-			std::unique_lock lk(m_mutexInstructions);
-			m_cvInstructions.wait(lk);
+			m_cvInstructions.wait_until(lk, m_wheelStart + TIMER_TICK * static_cast<int64_t>(nextTick),
+				hasInstructions);
 		}
 	}
 
 }
 
-void impl_ns::ExecutionManager::TimerThread::ProcessTimerMessage(const TimerMessage& msg)
+void impl_ns::ExecutionManager::TimerThread::ProcessTimerMessage(TimerMessage& msg)
 {
 	// Add or set a timer
 	if (msg.tag == TimerInstructionTag::Set)
 	{
-		// Find the timer with the given name (if the name is not nullptr)
-		bool timerFound{ false };
+		auto nextBeat = std::chrono::steady_clock::now() + msg.timerDef.timeInterval;
+
+		// A named timer which exists already is rescheduled
 		if (!msg.timerDef.timerName.empty())
 		{
-			for (auto& timerState : m_timerStates)
+			auto itName = m_namedTimers.find(msg.timerDef.timerName);
+			if (itName != m_namedTimers.end())
 			{
-				if (timerState.second.timerDef.timerName == msg.timerDef.timerName)
-				{
-					// Update
-					timerState.second.recalibrate = true;
-					timerState.second.timerDef = msg.timerDef;
-					timerFound = true;
-					break;
-				}
+				TimerStateWrapper& timerState = m_timerStates.find(itName->second)->second;
+				UnlinkFromWheel(timerState);
+				timerState.timerDef = std::move(msg.timerDef);
+				timerState.nextBeat = nextBeat;
+				ScheduleTimer(timerState);
+				return;
 			}
 		}
 
-		if (!timerFound)
+		// Skip IDs still held by very old timers once the counter wraps
+		std::pair<std::unordered_map<TimerID, TimerStateWrapper>::iterator, bool> emplResult;
+		do
 		{
-			// Add a new timer.  Also give it its first entry in the priority queue
-			size_t newTimerIndex = m_nextTimerIndex++;
-			auto emplResult = m_timerStates.emplace(newTimerIndex, TimerStateWrapper());
-
-			emplResult.first->second.recalibrate = true;
-			emplResult.first->second.timerDef = msg.timerDef;
+			emplResult = m_timerStates.emplace(m_nextTimerIndex++, TimerStateWrapper());
+		} while (!emplResult.second);
 
-			TimerPriorityEntry timerEntry;
-			timerEntry.timerIndex = newTimerIndex;
-			timerEntry.nextBeat = std::chrono::steady_clock::now();
-			timerEntry.nextBeat += msg.timerDef.timeInterval;
-
-			m_timerPriorities.emplace(timerEntry);
+		TimerStateWrapper& timerState = emplResult.first->second;
+		timerState.timerID = emplResult.first->first;
+		if (!msg.timerDef.timerName.empty())
+		{
+			m_namedTimers.emplace(msg.timerDef.timerName, timerState.timerID);
 		}
+		timerState.timerDef = std::move(msg.timerDef);
+		timerState.nextBeat = nextBeat;
+		ScheduleTimer(timerState);
 	}
 	else if (msg.tag == TimerInstructionTag::Cancel)
 	{
-		// Cancel a timer
-		// Find it and remove it from the map
-
 		if (!msg.timerDef.timerName.empty())
 		{
-			for (auto itTimer = m_timerStates.begin();
-				itTimer != m_timerStates.end();
-				++itTimer)
+			auto itName = m_namedTimers.find(msg.timerDef.timerName);
+			if (itName != m_namedTimers.end())
 			{
-				if (itTimer->second.timerDef.timerName == msg.timerDef.timerName)
-				{
-					m_timerStates.erase(itTimer);
-					break;
-				}
+				RemoveTimer(m_timerStates.find(itName->second));
 			}
 		}
 		else
 		{
-			m_timerStates.erase(msg.timerID);
+			RemoveTimer(m_timerStates.find(msg.timerID));
 		}
 	}
 
 }
 
-impl_ns::ExecutionManager::TimerThread::TimerAction 
-	impl_ns::ExecutionManager::TimerThread::OnTimerDue(TimerPriorityEntry& timerEntry)
+void impl_ns::ExecutionManager::TimerThread::RemoveTimer(std::unordered_map<TimerID, TimerStateWrapper>::iterator itTimer)
 {
-	bool shouldRemoveFromMap{ false };
-	TimerAction retValue{ TimerAction::Reinsert };
-
-	// Look up the timer
-	auto itTimer = m_timerStates.find(timerEntry.timerIndex);
-
 	if (itTimer == m_timerStates.end())
 	{
-		return TimerAction::Remove;
+		return;
 	}
 
-	itTimer->second.timerDef.pCallback->OnTimer(itTimer->second.timerDef.timerUserID,
-												timerEntry.timerIndex);
-
-	if (!itTimer->second.recalibrate
-		&& !itTimer->second.timerDef.repeatingTimer)
+	UnlinkFromWheel(itTimer->second);
+	if (!itTimer->second.timerDef.timerName.empty())
 	{
-		retValue = TimerAction::Remove;
-		shouldRemoveFromMap = true;
+		m_namedTimers.erase(itTimer->second.timerDef.timerName);
 	}
+	m_timerStates.erase(itTimer);
+}
 
-	if (shouldRemoveFromMap)
+uint64_t impl_ns::ExecutionManager::TimerThread::TickOf(std::chrono::time_point<std::chrono::steady_clock> timePoint) const
+{
+	if (timePoint <= m_wheelStart)
 	{
-		m_timerStates.erase(itTimer);
+		return 0;
 	}
-	else
+	return static_cast<uint64_t>((timePoint - m_wheelStart) / TIMER_TICK);
+}
+
+void impl_ns::ExecutionManager::TimerThread::ScheduleTimer(TimerStateWrapper& timerState)
+{
+	// Round up, so that the timer never fires before nextBeat
+	uint64_t expiryTick = TickOf(timerState.nextBeat);
+	if (m_wheelStart + TIMER_TICK * static_cast<int64_t>(expiryTick) < timerState.nextBeat)
 	{
-		// Otherwise, update the next wakeup state
-		timerEntry.nextBeat += itTimer->second.timerDef.timeInterval;
-		// Set recalibrate to false
-		itTimer->second.recalibrate = false;
+		++expiryTick;
 	}
-	return retValue;
-}
 
-thread_local std::string impl_ns::ExecutionManager::m_tlThreadName{ "" };
+	// The current tick has been fired already
+	timerState.earliestTick = std::max(expiryTick, m_currentTick + 1);
+	timerState.expiryTick = timerState.earliestTick;
 
-impl_ns::ExecutionManager::ExecutionManager()
-	:m_idleTimeout(SingletonConfig::GetInstance().GetDurationUS("execution_microsecond_wait"))
-{
-	m_pTimerThread.reset(new TimerThread());
-	// OK, as long as TimerThread doesn't reference execution manager!
-	m_pTimerThread->StartMe();
+	if (timerState.timerDef.slack.count() > 0)
+	{
+		uint64_t latestTick = TickOf(timerState.nextBeat + timerState.timerDef.slack);
+		if (latestTick > timerState.earliestTick)
+		{
+			// Below the highest bit where they differ, latestTick can be cleared without
+			// dropping under earliestTick
+			unsigned topBit = HighestBit(latestTick ^ timerState.earliestTick);
+			timerState.expiryTick = latestTick & ~((uint64_t(1) << topBit) - 1);
+		}
+	}
+	InsertIntoWheel(timerState);
 }
 
-void impl_ns::ExecutionManager::LockShop(bool sendTermination)
+void impl_ns::ExecutionManager::TimerThread::InsertIntoWheel(TimerStateWrapper& timerState)
 {
-	std::unique_lock lk{ m_mutex };
-	
+	uint64_t expiryTick = std::max(timerState.expiryTick, m_currentTick);
+	uint64_t delta = expiryTick - m_currentTick;
+
+	size_t level = 0;
+	while (level + 1 < WHEEL_LEVELS
+		&& delta >= (uint64_t(1) << (WHEEL_SLOT_BITS * (level + 1))))
+	{
+		++level;
+	}
+
+	// Deadlines beyond the top level wait in its farthest slot and are placed again when
+	// that slot cascades
+	constexpr uint64_t wheelSpan = uint64_t(1) << (WHEEL_SLOT_BITS * WHEEL_LEVELS);
+	uint64_t slotTick = std::min(expiryTick, m_currentTick + wheelSpan - 1);
+
+	size_t slot = static_cast<size_t>(slotTick >> (WHEEL_SLOT_BITS * level)) & WHEEL_SLOT_MASK;
+	size_t slotIndex = level * WHEEL_SLOTS + slot;
+
+	timerState.slotIndex = slotIndex;
+	timerState.pPrev = nullptr;
+	timerState.pNext = m_wheel[slotIndex];
+	if (timerState.pNext)
+	{
+		timerState.pNext->pPrev = &timerState;
+	}
+	else
+	{
+		++m_slotsInUse;
+	}
+	m_wheel[slotIndex] = &timerState;
+	m_occupied[level][slot / 64] |= uint64_t(1) << (slot % 64);
+}
+
+void impl_ns::ExecutionManager::TimerThread::UnlinkFromWheel(TimerStateWrapper& timerState)
+{
+	if (timerState.slotIndex == NO_SLOT)
+	{
+		return;
+	}
+
+	if (timerState.pPrev)
+	{
+		timerState.pPrev->pNext = timerState.pNext;
+	}
+	else
+	{
+		m_wheel[timerState.slotIndex] = timerState.pNext;
+		if (!timerState.pNext)
+		{
+			--m_slotsInUse;
+			size_t slot = timerState.slotIndex & WHEEL_SLOT_MASK;
+			m_occupied[timerState.slotIndex / WHEEL_SLOTS][slot / 64] &= ~(uint64_t(1) << (slot % 64));
+		}
+	}
+
+	if (timerState.pNext)
+	{
+		timerState.pNext->pPrev = timerState.pPrev;
+	}
+
+	timerState.pPrev = nullptr;
+	timerState.pNext = nullptr;
+	timerState.slotIndex = NO_SLOT;
+}
+
+impl_ns::ExecutionManager::TimerThread::TimerStateWrapper*
+	impl_ns::ExecutionManager::TimerThread::DetachSlot(size_t level, size_t slot)
+{
+	size_t slotIndex = level * WHEEL_SLOTS + slot;
+	TimerStateWrapper* pTimers = m_wheel[slotIndex];
+	if (pTimers)
+	{
+		--m_slotsInUse;
+	}
+
+	m_wheel[slotIndex] = nullptr;
+	m_occupied[level][slot / 64] &= ~(uint64_t(1) << (slot % 64));
+	return pTimers;
+}
+
+uint64_t impl_ns::ExecutionManager::TimerThread::NextEventTick() const
+{
+	if (m_timerStates.empty())
+	{
+		return NO_TICK;
+	}
+
+	// A slot of level 0 fires at its own tick; a slot of a higher level cascades at the
+	// first tick of its range
+	uint64_t nextTick = NO_TICK;
+	for (size_t level = 0; level < WHEEL_LEVELS; ++level)
+	{
+		size_t shift = WHEEL_SLOT_BITS * level;
+		uint64_t levelTick = (m_currentTick >> shift) + 1;
+		int distance = NextSetBit(m_occupied[level], static_cast<size_t>(levelTick) & WHEEL_SLOT_MASK);
+		if (distance >= 0)
+		{
+			nextTick = std::min(nextTick, (levelTick + distance) << shift);
+		}
+	}
+	return nextTick;
+}
+
+void impl_ns::ExecutionManager::TimerThread::AdvanceTo(uint64_t targetTick)
+{
+	while (m_currentTick < targetTick)
+	{
+		// Skip straight past ticks where nothing happens
+		uint64_t nextTick = NextEventTick();
+		if (nextTick > targetTick)
+		{
+			m_currentTick = targetTick;
+			break;
+		}
+
+		m_currentTick = nextTick;
+
+		// Higher levels first, so that a timer can drop through several levels at once
+		for (size_t level = WHEEL_LEVELS - 1; level > 0; --level)
+		{
+			size_t shift = WHEEL_SLOT_BITS * level;
+			if ((nextTick & ((uint64_t(1) << shift) - 1)) == 0)
+			{
+				TimerStateWrapper* pTimer = DetachSlot(level, static_cast<size_t>(nextTick >> shift) & WHEEL_SLOT_MASK);
+				while (pTimer)
+				{
+					TimerStateWrapper* pNext = pTimer->pNext;
+					InsertIntoWheel(*pTimer);
+					pTimer = pNext;
+				}
+			}
+		}
+
+		size_t firstDue = m_dueTimers.size();
+		TimerStateWrapper* pTimer = DetachSlot(0, static_cast<size_t>(nextTick) & WHEEL_SLOT_MASK);
+		while (pTimer)
+		{
+			TimerStateWrapper* pNext = pTimer->pNext;
+			pTimer->pPrev = nullptr;
+			pTimer->pNext = nullptr;
+			pTimer->slotIndex = NO_SLOT;
+			m_dueTimers.push_back(pTimer);
+			pTimer = pNext;
+		}
+
+		if (m_dueTimers.size() > firstDue)
+		{
+			CountWakeup(firstDue);
+		}
+	}
+}
+
+void impl_ns::ExecutionManager::TimerThread::CountWakeup(size_t firstDue)
+{
+	// Forget what is now too old to be told apart from the ticks coming in
+	if (m_currentTick - m_historyTick >= EARLIEST_HISTORY_TICKS)
+	{
+		std::fill(std::begin(m_earliestHistory), std::end(m_earliestHistory), 0);
+	}
+	else
+	{
+		for (uint64_t tick = m_historyTick + 1; tick <= m_currentTick; ++tick)
+		{
+			size_t bit = static_cast<size_t>(tick % EARLIEST_HISTORY_TICKS);
+			m_earliestHistory[bit / 64] &= ~(uint64_t(1) << (bit % 64));
+		}
+	}
+	m_historyTick = m_currentTick;
+
+	// Every earliest tick not seen before would have been a wakeup of its own
+	uint64_t newTicks{ 0 };
+	for (size_t dueIdx = firstDue; dueIdx < m_dueTimers.size(); ++dueIdx)
+	{
+		uint64_t earliestTick = m_dueTimers[dueIdx]->earliestTick;
+		if (earliestTick + EARLIEST_HISTORY_TICKS <= m_currentTick)
+		{
+			continue;
+		}
+
+		size_t bit = static_cast<size_t>(earliestTick % EARLIEST_HISTORY_TICKS);
+		uint64_t mask = uint64_t(1) << (bit % 64);
+		if (!(m_earliestHistory[bit / 64] & mask))
+		{
+			m_earliestHistory[bit / 64] |= mask;
+			++newTicks;
+		}
+	}
+
+	BumpCounter(m_wakeups);
+	BumpCounter(m_wakeupsWithoutSlack, newTicks);
+}
+
+impl_ns::TimerStats impl_ns::ExecutionManager::TimerThread::GetStats() const
+{
+	TimerStats stats;
+	stats.wakeups = m_wakeups.load(std::memory_order_relaxed);
+	uint64_t wakeupsWithoutSlack = m_wakeupsWithoutSlack.load(std::memory_order_relaxed);
+	stats.wakeupsSaved = wakeupsWithoutSlack > stats.wakeups ? wakeupsWithoutSlack - stats.wakeups : 0;
+	stats.activeTimers = m_activeTimers.load(std::memory_order_relaxed);
+	stats.wheelSlotsInUse = m_publishedSlotsInUse.load(std::memory_order_relaxed);
+
+	for (size_t bucket = 0; bucket < TimerStats::HISTOGRAM_BUCKETS; ++bucket)
+	{
+		stats.lateness[bucket] = m_lateness[bucket].load(std::memory_order_relaxed);
+		stats.callbackDuration[bucket] = m_callbackDuration[bucket].load(std::memory_order_relaxed);
+	}
+	return stats;
+}
+
+void impl_ns::ExecutionManager::TimerThread::FireDueTimers()
+{
+	// Instructions are only processed between batches, so no timer in the batch can be
+	// removed while it runs
+	auto curTime = std::chrono::steady_clock::now();
+	for (TimerStateWrapper* pTimer : m_dueTimers)
+	{
+		BumpCounter(m_lateness[TimerHistogramBucket(curTime - pTimer->nextBeat)]);
+
+		if (pTimer->timerDef.ownerExecutor == EXEC_WILDCARD)
+		{
+			pTimer->timerDef.pCallback->OnTimer(pTimer->timerDef.timerUserID, pTimer->timerID);
+
+			auto callbackEnd = std::chrono::steady_clock::now();
+			BumpCounter(m_callbackDuration[TimerHistogramBucket(callbackEnd - curTime)]);
+			curTime = callbackEnd;
+		}
+		else
+		{
+			m_deliveries[pTimer->timerDef.ownerExecutor].push_back(
+				ExpiredTimer{ pTimer->timerDef.pCallback, pTimer->timerDef.timerUserID, pTimer->timerID });
+		}
+
+		if (pTimer->timerDef.repeatingTimer)
+		{
+			pTimer->nextBeat += pTimer->timerDef.timeInterval;
+			ScheduleTimer(*pTimer);
+		}
+		else
+		{
+			RemoveTimer(m_timerStates.find(pTimer->timerID));
+		}
+	}
+	m_dueTimers.clear();
+
+	for (auto& delivery : m_deliveries)
+	{
+		if (!ExecutionManager::GetInstance().DeliverTimers(delivery.first, delivery.second))
+		{
+			// The owner is gone, so its repeating timers are too
+			for (const ExpiredTimer& expired : delivery.second)
+			{
+				RemoveTimer(m_timerStates.find(expired.timerID));
+			}
+		}
+	}
+	m_deliveries.clear();
+}
+
+// ExecutorPool
+impl_ns::ExecutionManager::ExecutorPool::ExecutorPool(size_t workerCount)
+	:m_workerCount(workerCount),
+	m_workers(new Worker[workerCount])
+{
+
+}
+
+void impl_ns::ExecutionManager::ExecutorPool::StartMe()
+{
+	m_runningWorkers.store(m_workerCount);
+	for (size_t workerIdx = 0; workerIdx < m_workerCount; ++workerIdx)
+	{
+		m_workers[workerIdx].thread = std::thread(&ExecutionManager::ExecutorPool::operator(), this, workerIdx);
+	}
+}
+
+void impl_ns::ExecutionManager::ExecutorPool::JoinMe()
+{
+	for (size_t workerIdx = 0; workerIdx < m_workerCount; ++workerIdx)
+	{
+		m_workers[workerIdx].thread.join();
+	}
+}
+
+void impl_ns::ExecutionManager::ExecutorPool::DoomMe()
+{
+	std::unique_lock lk{ m_mutexIdle };
+	m_isDoomed.store(true);
+	m_cvIdle.notify_all();
+}
+
+bool impl_ns::ExecutionManager::ExecutorPool::IsFinished() const
+{
+	return m_isDoomed.load() && m_executorCount.load() == 0;
+}
+
+void impl_ns::ExecutionManager::ExecutorPool::PostAddExecutor(ExecutorID execId,
+	const std::string& threadName,
+	std::shared_ptr<IExecutor> pExecutor)
+{
+	PooledExecutor* pPooled{ nullptr };
+	{
+		std::unique_lock lk{ m_mutexExecutors };
+		auto pNewPooled = std::make_unique<PooledExecutor>(execId, threadName, std::move(pExecutor));
+		pPooled = pNewPooled.get();
+		m_executors.emplace(execId, std::move(pNewPooled));
+		++m_executorCount;
+	}
+
+	// Starts out queued, so that a worker calls Init()
+	Schedule(pPooled, m_nextWorker++ % m_workerCount);
+}
+
+void impl_ns::ExecutionManager::ExecutorPool::PostSignalExecutor(ExecutorID execId,
+	ExecutorSignalType signalType)
+{
+	std::shared_lock lk{ m_mutexExecutors };
+	auto itPooled = m_executors.find(execId);
+
+	if (itPooled != m_executors.end())
+	{
+		SignalPooled(*itPooled->second, signalType);
+	}
+}
+
+bool impl_ns::ExecutionManager::ExecutorPool::PostTimers(ExecutorID execId,
+	std::vector<ExpiredTimer>& expiredTimers)
+{
+	std::shared_lock lk{ m_mutexExecutors };
+	auto itPooled = m_executors.find(execId);
+
+	if (itPooled == m_executors.end())
+	{
+		return false;
+	}
+
+	PooledExecutor& rPooled = *itPooled->second;
+	{
+		std::unique_lock lkTimers{ rPooled.mutexTimers };
+		rPooled.expiredTimers.insert(rPooled.expiredTimers.end(),
+			std::make_move_iterator(expiredTimers.begin()),
+			std::make_move_iterator(expiredTimers.end()));
+		rPooled.timersPending.store(true);
+	}
+	SignalPooled(rPooled, ExecutorSignalType::WakeUp);
+	return true;
+}
+
+void impl_ns::ExecutionManager::ExecutorPool::PostSignalAll(ExecutorSignalType signalType)
+{
+	std::shared_lock lk{ m_mutexExecutors };
+	for (auto& pooled : m_executors)
+	{
+		SignalPooled(*pooled.second, signalType);
+	}
+}
+
+void impl_ns::ExecutionManager::ExecutorPool::SignalPooled(PooledExecutor& rPooled,
+	ExecutorSignalType signalType)
+{
+	if (signalType == ExecutorSignalType::RequestTermination)
+	{
+		// Delivered by the worker, before the next Run()
+		rPooled.terminationRequested.store(true);
+	}
+
+	// Every signal is also a wakeup
+	PooledStateTag stateTag = rPooled.stateTag.load();
+	while (true)
+	{
+		if (stateTag == PooledStateTag::Suspended)
+		{
+			if (rPooled.stateTag.compare_exchange_weak(stateTag, PooledStateTag::Queued))
+			{
+				Schedule(&rPooled, m_nextWorker++ % m_workerCount);
+				return;
+			}
+		}
+		else if (stateTag == PooledStateTag::Running)
+		{
+			if (rPooled.stateTag.compare_exchange_weak(stateTag, PooledStateTag::RunningSignalled))
+			{
+				return;
+			}
+		}
+		else
+		{
+			// Already on its way
+			return;
+		}
+	}
+}
+
+void impl_ns::ExecutionManager::ExecutorPool::Schedule(PooledExecutor* pPooled, size_t workerIdx)
+{
+	// Counted before it is pushed, so that the count never goes below zero when a thief
+	// gets there first
+	++m_queuedCount;
+	{
+		Worker& rWorker = m_workers[workerIdx];
+		std::unique_lock lk{ rWorker.mutexQueue };
+		rWorker.runQueue.push_back(pPooled);
+	}
+
+	// Idle workers count themselves in before they check the queued count, so one of the two
+	// sides sees the other
+	if (m_idleWorkers.load() > 0)
+	{
+		std::unique_lock lk{ m_mutexIdle };
+		m_cvIdle.notify_one();
+	}
+}
+
+impl_ns::ExecutionManager::ExecutorPool::PooledExecutor* 
+	impl_ns::ExecutionManager::ExecutorPool::TakeWork(size_t workerIdx)
+{
+	if (m_queuedCount.load() == 0)
+	{
+		return nullptr;
+	}
+
+	PooledExecutor* pPooled{ nullptr };
+	{
+		// Oldest first, so that executors that keep returning Continue take turns
+		Worker& rWorker = m_workers[workerIdx];
+		std::unique_lock lk{ rWorker.mutexQueue };
+		if (!rWorker.runQueue.empty())
+		{
+			pPooled = rWorker.runQueue.front();
+			rWorker.runQueue.pop_front();
+		}
+	}
+
+	// Steal from the other end
+	for (size_t offset = 1; !pPooled && offset < m_workerCount; ++offset)
+	{
+		Worker& rVictim = m_workers[(workerIdx + offset) % m_workerCount];
+		std::unique_lock lk{ rVictim.mutexQueue };
+		if (!rVictim.runQueue.empty())
+		{
+			pPooled = rVictim.runQueue.back();
+			rVictim.runQueue.pop_back();
+		}
+	}
+
+	if (pPooled)
+	{
+		--m_queuedCount;
+	}
+	return pPooled;
+}
+
+void impl_ns::ExecutionManager::ExecutorPool::RunPooled(PooledExecutor* pPooled, size_t workerIdx)
+{
+	pPooled->stateTag.store(PooledStateTag::Running);
+	ExecutionManager::m_tlThreadName = pPooled->threadName;
+
+	if (!pPooled->initialized)
+	{
+		if (!pPooled->pExecutor->Init())
+		{
+			RemovePooled(pPooled);
+			return;
+		}
+		pPooled->initialized = true;
+	}
+
+	if (pPooled->terminationRequested.exchange(false))
+	{
+		pPooled->pExecutor->TerminationRequested();
+	}
+
+	if (pPooled->timersPending.exchange(false))
+	{
+		std::vector<ExpiredTimer> expiredTimers;
+		{
+			std::unique_lock lkTimers{ pPooled->mutexTimers };
+			std::swap(expiredTimers, pPooled->expiredTimers);
+		}
+
+		for (const ExpiredTimer& expired : expiredTimers)
+		{
+			expired.pCallback->OnTimer(expired.timerUserID, expired.timerID);
+		}
+	}
+
+	ExecutionArgs execArgs;
+	ExecutionState nextState = pPooled->pExecutor->Run(execArgs);
+
+	if (nextState == ExecutionState::End)
+	{
+		pPooled->pExecutor->DeInit();
+		RemovePooled(pPooled);
+		return;
+	}
+
+	if (nextState == ExecutionState::Suspend)
+	{
+		PooledStateTag stateTag{ PooledStateTag::Running };
+		if (pPooled->stateTag.compare_exchange_strong(stateTag, PooledStateTag::Suspended))
+		{
+			return;
+		}
+		// Signalled meanwhile
+	}
+
+	// Back of our own queue: the others get a turn first
+	pPooled->stateTag.store(PooledStateTag::Queued);
+	Schedule(pPooled, workerIdx);
+}
+
+void impl_ns::ExecutionManager::ExecutorPool::RemovePooled(PooledExecutor* pPooled)
+{
+	ExecutorID execId = pPooled->execId;
+	{
+		std::unique_lock lk{ m_mutexExecutors };
+		m_executors.erase(execId);
+		--m_executorCount;
+	}
+
+	ExecutionManager::GetInstance().RemoveExecutors(std::vector<ExecutorID>{ execId });
+
+	if (IsFinished())
+	{
+		std::unique_lock lk{ m_mutexIdle };
+		m_cvIdle.notify_all();
+	}
+}
+
+void impl_ns::ExecutionManager::ExecutorPool::operator()(size_t workerIdx)
+{
+	while (true)
+	{
+		PooledExecutor* pPooled = TakeWork(workerIdx);
+		if (pPooled)
+		{
+			RunPooled(pPooled, workerIdx);
+			continue;
+		}
+
+		std::unique_lock lk{ m_mutexIdle };
+		if (IsFinished())
+		{
+			break;
+		}
+
+		++m_idleWorkers;
+		m_cvIdle.wait(lk, [this]()
+			{
+				return m_queuedCount.load() > 0 || IsFinished();
+			});
+		--m_idleWorkers;
+	}
+
+	// The last worker out tells the manager
+	if (--m_runningWorkers == 0)
+	{
+		ExecutionManager::GetInstance().RemovePool();
+	}
+}
+
+thread_local std::string impl_ns::ExecutionManager::m_tlThreadName{ "" };
+
+impl_ns::ExecutionManager::ExecutionManager()
+	:m_poolWorkerCount(SingletonConfig::GetInstance().GetUnsignedInt("execution_pool_threads"))
+{
+	m_pTimerThread.reset(new TimerThread());
+	// OK, as long as TimerThread doesn't reference execution manager!
+	// It only does so to deliver timers owned by an executor, which cannot exist yet
+	m_pTimerThread->StartMe();
+}
+
+void impl_ns::ExecutionManager::LockShop(bool sendTermination)
+{
+	std::unique_lock lk{ m_mutex };
+	
 	// Lock up shop by dooming all threads and requesting termination
 	for (const auto& thread : m_threadMap)
 	{
@@ -510,6 +1504,15 @@ void impl_ns::ExecutionManager::LockShop(bool sendTermination)
 			thread.second->PostSignalAll(ExecutorSignalType::RequestTermination);
 		}
 	}
+
+	if (m_pPool)
+	{
+		m_pPool->DoomMe();
+		if (sendTermination)
+		{
+			m_pPool->PostSignalAll(ExecutorSignalType::RequestTermination);
+		}
+	}
 	LockedShopUpdateState();
 	m_cvExecution.notify_all();
 }
@@ -518,7 +1521,7 @@ void impl_ns::ExecutionManager::RunLoop(std::chrono::microseconds wakeUpTime)
 {
 	std::shared_lock lk{ m_mutex };
 
-	while (!m_lockedShop || !m_threadMap.empty())
+	while (!m_lockedShop || HasThreads())
 	{
 		m_cvExecution.wait_for(lk, wakeUpTime);
 	}
@@ -535,7 +1538,7 @@ impl_ns::ExecutionManager::~ExecutionManager()
 			std::terminate();
 		}
 
-		if (!m_threadMap.empty())
+		if (HasThreads())
 		{
 			std::cerr << "Abnormal termination of ExecutionManager: active threads";
 			std::terminate();
@@ -547,12 +1550,17 @@ impl_ns::ExecutionManager::~ExecutionManager()
 		pThread->JoinMe();
 	}
 
+	if (m_pPool)
+	{
+		m_pPool->JoinMe();
+	}
+
 	m_pTimerThread->JoinMe();
 
 }
 
 
-impl_ns::ExecutorID impl_ns::ExecutionManager::AddExecutor(const char* pThreadName,
+impl_ns::ExecutorHandle impl_ns::ExecutionManager::AddExecutor(const char* pThreadName,
 	const std::shared_ptr<IExecutor>& pExecutor,
 	bool isSingleton)
 {
@@ -566,7 +1574,7 @@ impl_ns::ExecutorID impl_ns::ExecutionManager::AddExecutor(const char* pThreadNa
 	if (m_lockedShop)
 	{
 		// Locked shop -- can no longer add threads or executors
-		return EXEC_WILDCARD;
+		return ExecutorHandle();
 	}
 
 	std::string sThreadName(pThreadName);
@@ -574,7 +1582,23 @@ impl_ns::ExecutorID impl_ns::ExecutionManager::AddExecutor(const char* pThreadNa
 	// Assign a new ID to the executor
 	ExecutorID execId = m_nextExec++;
 
+	if (!isSingleton && m_poolWorkerCount > 0)
+	{
+		if (!m_pPool)
+		{
+			m_pPool = std::make_unique<ExecutorPool>(m_poolWorkerCount);
+			m_pPool->StartMe();
+			m_poolRunning = true;
+		}
+
+		m_pPool->PostAddExecutor(execId, sThreadName, pExecutor);
+		m_executorMap.emplace(execId, POOL_THREAD_ID);
+		m_cvExecution.notify_all();
+		return ExecutorHandle(execId, nullptr);
+	}
+
 	ThreadID threadId{ 0 };
+	std::shared_ptr<ExecutorSignalSlot> pSlot;
 	auto itThreadID = m_threadNameMap.find(sThreadName);
 
 	if (itThreadID != m_threadNameMap.end())
@@ -587,15 +1611,25 @@ impl_ns::ExecutorID impl_ns::ExecutionManager::AddExecutor(const char* pThreadNa
 		{
 			throw ExecutorStateException();
 		}
-		itThread->second->PostAddExecutor(execId, pExecutor);
+		pSlot = std::make_shared<ExecutorSignalSlot>(itThread->second.get());
+		itThread->second->PostAddExecutor(execId, pExecutor, pSlot);
 	}
 	else
 	{
 		// Create a new thread
+		ExecutorThreadOptions threadOptions;
+		auto itOptions = m_threadOptions.find(sThreadName);
+		if (itOptions != m_threadOptions.end())
+		{
+			threadOptions = itOptions->second;
+		}
+
 		auto pThread = std::make_shared<ExecutorThread>(m_nextThread,
-			sThreadName, isSingleton);
+			sThreadName, isSingleton, threadOptions);
+		pSlot = std::make_shared<ExecutorSignalSlot>(pThread.get());
 		pThread->StartMe(execId,
-			pExecutor);
+			pExecutor,
+			pSlot);
 
 		threadId = m_nextThread;
 		++m_nextThread;
@@ -609,7 +1643,20 @@ impl_ns::ExecutorID impl_ns::ExecutionManager::AddExecutor(const char* pThreadNa
 
 	m_cvExecution.notify_all();
 
-	return execId;
+	return ExecutorHandle(execId, std::move(pSlot));
+}
+
+bool impl_ns::ExecutionManager::ConfigureThread(const char* pThreadName, const ExecutorThreadOptions& options)
+{
+	std::unique_lock lk{ m_mutex };
+
+	if (!pThreadName || m_threadNameMap.count(pThreadName) > 0)
+	{
+		return false;
+	}
+
+	m_threadOptions[pThreadName] = options;
+	return true;
 }
 
 void impl_ns::ExecutionManager::DoomThread(const char* pThreadName)
@@ -627,6 +1674,22 @@ void impl_ns::ExecutionManager::DoomThread(const char* pThreadName)
 	m_cvExecution.notify_all();
 }
 
+bool impl_ns::ExecutionManager::AreOnSameThread(ExecutorID executorIdA, ExecutorID executorIdB)
+{
+	std::shared_lock lk{ m_mutex };
+
+	auto itThreadIDA = m_executorMap.find(executorIdA);
+	auto itThreadIDB = m_executorMap.find(executorIdB);
+
+	if (itThreadIDA == m_executorMap.end() || itThreadIDB == m_executorMap.end())
+	{
+		return false;
+	}
+
+	return executorIdA == executorIdB
+		|| (itThreadIDA->second == itThreadIDB->second && itThreadIDA->second != POOL_THREAD_ID);
+}
+
 bool impl_ns::ExecutionManager::SignalExecutor(ExecutorID executorId, ExecutorSignalType signalType)
 {
 	std::shared_lock lk{ m_mutex };
@@ -636,6 +1699,12 @@ bool impl_ns::ExecutionManager::SignalExecutor(ExecutorID executorId, ExecutorSi
 
 	if (itThreadID != m_executorMap.end())
 	{
+		if (itThreadID->second == POOL_THREAD_ID)
+		{
+			m_pPool->PostSignalExecutor(executorId, signalType);
+			return true;
+		}
+
 		auto itThread = m_threadMap.find(itThreadID->second);
 		itThread->second->PostSignalExecutor(executorId, signalType);
 		return true;
@@ -644,11 +1713,24 @@ bool impl_ns::ExecutionManager::SignalExecutor(ExecutorID executorId, ExecutorSi
 	return false;
 }
 
+bool impl_ns::ExecutionManager::SignalExecutor(const ExecutorHandle& handle, ExecutorSignalType signalType)
+{
+	if (!handle.m_pSlot)
+	{
+		return SignalExecutor(handle.m_execId, signalType);
+	}
+
+	handle.m_pSlot->pThread->PostSlotSignal(*handle.m_pSlot, signalType);
+	return true;
+}
+
 bool impl_ns::ExecutionManager::SetTimer(const char* pTimerName,
 	unsigned long microInterval,
 	bool repeatingTimer,
 	TimerUserID timerUserID,
-	std::shared_ptr<ITimerCallback> pCallback)
+	std::shared_ptr<ITimerCallback> pCallback,
+	ExecutorID ownerExecutor,
+	unsigned long microSlack)
 {
 	if (!pCallback)
 	{
@@ -659,7 +1741,35 @@ bool impl_ns::ExecutionManager::SetTimer(const char* pTimerName,
 		microInterval, 
 		repeatingTimer, 
 		timerUserID,
-		std::move(pCallback));
+		std::move(pCallback),
+		ownerExecutor,
+		microSlack);
+	return true;
+}
+
+impl_ns::TimerStats impl_ns::ExecutionManager::GetTimerStats() const
+{
+	return m_pTimerThread->GetStats();
+}
+
+bool impl_ns::ExecutionManager::DeliverTimers(ExecutorID ownerExecutor, std::vector<ExpiredTimer>& expiredTimers)
+{
+	std::shared_lock lk{ m_mutex };
+
+	auto itThreadID = m_executorMap.find(ownerExecutor);
+
+	if (itThreadID == m_executorMap.end())
+	{
+		return false;
+	}
+
+	if (itThreadID->second == POOL_THREAD_ID)
+	{
+		return m_pPool->PostTimers(ownerExecutor, expiredTimers);
+	}
+
+	auto itThread = m_threadMap.find(itThreadID->second);
+	itThread->second->PostTimers(ownerExecutor, std::move(expiredTimers));
 	return true;
 }
 
@@ -705,7 +1815,7 @@ void impl_ns::ExecutionManager::RemoveThread(ThreadID threadId)
 	// Move the thread to the "to join" category
 	m_threadsToJoin.emplace_back(pThread);
 
-	if (m_threadMap.empty())
+	if (!HasThreads())
 	{
 		// This works on the assumption that execution should finish when all threads exit
 		// This could of course be wrong -- the controlling thread may want to repopulate the 
@@ -717,6 +1827,19 @@ void impl_ns::ExecutionManager::RemoveThread(ThreadID threadId)
 
 
 
+void impl_ns::ExecutionManager::RemovePool()
+{
+	std::unique_lock lk{ m_mutex };
+
+	// The pool is joined with the manager, like the threads in m_threadsToJoin
+	m_poolRunning = false;
+	if (!HasThreads())
+	{
+		LockedShopUpdateState();
+	}
+	m_cvExecution.notify_all();
+}
+
 void impl_ns::ExecutionManager::LockedShopUpdateState()
 {
 	if (!m_lockedShop)
@@ -1,7 +1,9 @@
 #pragma once
 #include "IExecutor.h"
+#include "EventCount.h"
 
 #include <memory>
+#include <array>
 #include <atomic>
 #include <vector>
 #include <unordered_map>
@@ -9,16 +11,13 @@
 #include <mutex>
 #include <string>
 #include <condition_variable>
+#include <thread>
 #include <shared_mutex>
 #include <chrono>
-#include <queue>
+#include <deque>
 
 namespace holder::base
 {
-	using ExecutorID = uint32_t;
-
-	constexpr ExecutorID EXEC_WILDCARD = 0xffffffff;
-
 	enum class ExecutorSignalType
 	{
 		WakeUp,
@@ -27,6 +26,73 @@ namespace holder::base
 
 	class ExecutorStateException { };
 
+	// Placement of a named executor thread.  Only takes effect if set before the thread is created
+	struct ExecutorThreadOptions
+	{
+		// CPUs the thread may run on.  Empty means any CPU, or those of numaNode
+		std::vector<unsigned int> cpuSet;
+		// When cpuSet is empty, run on the CPUs of this node; negative for no preference.
+		// The thread's own allocations follow through first touch
+		int numaNode{ -1 };
+		// With nothing to run, watch for work this long before parking.  Saves the wakeup
+		// latency at the price of a busy core; best combined with a dedicated CPU
+		std::chrono::microseconds spinBudget{ 0 };
+
+		bool HasPlacement() const { return !cpuSet.empty() || numaNode >= 0; }
+		bool IsDefault() const { return !HasPlacement() && spinBudget.count() == 0; }
+	};
+
+	// Counters of the timer thread, each read on its own
+	struct TimerStats
+	{
+		// Bucket i counts timers below 2^i microseconds, except for the last one, which takes
+		// everything longer
+		static constexpr size_t HISTOGRAM_BUCKETS = 24;
+
+		// Ticks at which the timer thread fired timers
+		uint64_t wakeups{ 0 };
+		// How many fewer wakeups there were than there would have been without slack.  Slack
+		// of more than about four seconds is not counted
+		uint64_t wakeupsSaved{ 0 };
+		// Set and neither cancelled nor fired for the last time
+		size_t activeTimers{ 0 };
+		// Slots of the wheel holding at least one timer
+		size_t wheelSlotsInUse{ 0 };
+		// From the deadline to the callback, or to the handover for timers owned by an
+		// executor.  Includes tick rounding, slack, and callbacks ahead in the same batch
+		std::array<uint64_t, HISTOGRAM_BUCKETS> lateness{};
+		// Callbacks run on the timer thread only
+		std::array<uint64_t, HISTOGRAM_BUCKETS> callbackDuration{};
+	};
+
+	// Where signals sent through an ExecutorHandle land.  Defined with the threads that own them
+	struct ExecutorSignalSlot;
+
+	// Returned by AddExecutor.  Signalling through a handle skips the executor and thread lookups
+	// and, for an executor that is already signalled, is a single atomic operation
+	class ExecutorHandle
+	{
+	public:
+		ExecutorHandle() = default;
+
+		ExecutorID GetExecutorID() const { return m_execId; }
+		bool IsValid() const { return m_execId != EXEC_WILDCARD; }
+		// A pooled executor may run on a different worker each time
+		bool IsPooled() const { return IsValid() && !m_pSlot; }
+
+	private:
+		friend class ExecutionManager;
+
+		ExecutorHandle(ExecutorID execId, std::shared_ptr<ExecutorSignalSlot> pSlot)
+			:m_execId(execId),
+			m_pSlot(std::move(pSlot))
+		{ }
+
+		ExecutorID m_execId{ EXEC_WILDCARD };
+		// Null for pooled executors, which are signalled by ID
+		std::shared_ptr<ExecutorSignalSlot> m_pSlot;
+	};
+
 	class ExecutionManager
 	{
 	private:
@@ -36,7 +102,8 @@ namespace holder::base
 		enum class ExecutionInstructionTag
 		{
 			AddExecutor,
-			SignalExecutor
+			SignalExecutor,
+			DeliverTimers
 		};
 
 		enum class TimerInstructionTag
@@ -45,12 +112,22 @@ namespace holder::base
 			Cancel
 		};
 
+		// A timer that fell due, on its way to the executor that owns it
+		struct ExpiredTimer
+		{
+			std::shared_ptr<ITimerCallback> pCallback;
+			TimerUserID timerUserID;
+			TimerID timerID;
+		};
+
 		struct ExecutionInstructionMessage
 		{
 			ExecutionInstructionTag instructionTag;
 			ExecutorSignalType signalType;
 			ExecutorID execId;
 			std::shared_ptr<IExecutor> executor;
+			std::shared_ptr<ExecutorSignalSlot> pSlot;
+			std::vector<ExpiredTimer> expiredTimers;
 		};
 
 		struct TimerDefinition
@@ -60,6 +137,10 @@ namespace holder::base
 			bool repeatingTimer;
 			TimerUserID timerUserID;
 			std::shared_ptr<ITimerCallback> pCallback;
+			// EXEC_WILDCARD: the callback runs on the timer thread
+			ExecutorID ownerExecutor{ EXEC_WILDCARD };
+			// How late the timer may fire
+			typename std::chrono::steady_clock::duration slack{ 0 };
 		};
 
 		struct TimerMessage
@@ -83,23 +164,30 @@ namespace holder::base
 				ExecutorID execId;
 				ExecutorStateTag stateTag;
 				std::shared_ptr<IExecutor> pExecutor;
+				std::shared_ptr<ExecutorSignalSlot> pSlot;
+				// Position in m_readyList while Executing
+				size_t readyPos{ 0 };
 
 				ExecutorState(ExecutorID execId_,
 					ExecutorStateTag stateTag_,
-					std::shared_ptr<IExecutor> pExecutor_)
+					std::shared_ptr<IExecutor> pExecutor_,
+					std::shared_ptr<ExecutorSignalSlot> pSlot_)
 					:execId(execId_),
 					stateTag(stateTag_),
-					pExecutor(pExecutor_)
+					pExecutor(pExecutor_),
+					pSlot(pSlot_)
 				{ }
 			};
 
 		public:
 			ExecutorThread(ThreadID id,
 				const std::string& threadName,
-				bool isSingleton);
+				bool isSingleton,
+				const ExecutorThreadOptions& options);
 
 			void StartMe(ExecutorID firstExecId,
-				std::shared_ptr<IExecutor> pFirstExecutor);
+				std::shared_ptr<IExecutor> pFirstExecutor,
+				std::shared_ptr<ExecutorSignalSlot> pFirstSlot);
 			void JoinMe();
 
 			const char* GetThreadName() const
@@ -110,10 +198,17 @@ namespace holder::base
 			bool IsSingleton() const { return m_isSingleton; }
 
 			void PostAddExecutor(ExecutorID execId,
-				std::shared_ptr<IExecutor> pExecutor);
+				std::shared_ptr<IExecutor> pExecutor,
+				std::shared_ptr<ExecutorSignalSlot> pSlot);
 			void PostSignalExecutor(ExecutorID execId,
 				ExecutorSignalType signalType);
 
+			// Signal through a handle.  Only queues the slot if it is not queued already
+			void PostSlotSignal(ExecutorSignalSlot& rSlot, ExecutorSignalType signalType);
+
+			// The callbacks run on this thread, and the executor is woken up
+			void PostTimers(ExecutorID execId, std::vector<ExpiredTimer>&& expiredTimers);
+
 			// Post a signal to all executors on this thread
 			void PostSignalAll(ExecutorSignalType signalType);
 			void DoomMe();
@@ -122,13 +217,26 @@ namespace holder::base
 		private:
 
 			void operator()(ExecutorID firstExecId, 
-				std::shared_ptr<IExecutor> pFirstExecutor);
+				std::shared_ptr<IExecutor> pFirstExecutor,
+				std::shared_ptr<ExecutorSignalSlot> pFirstSlot);
 
 			void AddExecutor(ExecutorID execId, 
-				std::shared_ptr<IExecutor> pExecutor);
+				std::shared_ptr<IExecutor> pExecutor,
+				std::shared_ptr<ExecutorSignalSlot> pSlot);
+			void HandleSlotSignals();
 			void HandleExecutorSignal(ExecutorID execId, ExecutorSignalType signalType);
 
 			void HandleSignalForIndex(size_t execIndex, ExecutorSignalType signalType);
+			void HandleExpiredTimers(ExecutorID execId, const std::vector<ExpiredTimer>& expiredTimers);
+
+			void MakeReady(size_t execIndex);
+
+			// Spin mode.  Returns true as soon as instructions or signals arrive, false once
+			// the budget is spent
+			bool SpinForWork();
+
+			// Run everything on the ready list once
+			void RunReady();
 
 			// Remove executor from the array
 			void RemoveExecutor(ExecutorID execId);
@@ -137,19 +245,31 @@ namespace holder::base
 			ThreadID m_threadId;
 			std::string m_threadName;
 			bool m_isSingleton;
+			ExecutorThreadOptions m_options;
 
 			std::thread m_thread;
 
 			// Messaging
 			std::atomic<bool>   m_newInstructions{ false };
 			std::mutex m_mutexInstructions;
-			std::condition_variable m_cvInstructions;
 			std::vector<ExecutionInstructionMessage>  m_instructionList;
 			bool  m_isDoomed{ false };
-
-			// Once this goes to zero, the thread goes to sleep waiting for someone to 
-			// be signalled
-			unsigned int m_nActive{ 0 };
+			// Where the thread sleeps when nothing is ready.  Posts, slot signals and DoomMe
+			// notify it; there is no periodic wakeup
+			lib::EventCount m_eventCount;
+
+			// Slots signalled through handles, pushed by any thread and taken all at once
+			std::atomic<ExecutorSignalSlot*> m_signalledSlots{ nullptr };
+			// Slots of removed executors that may still be on m_signalledSlots
+			std::vector<std::shared_ptr<ExecutorSignalSlot> > m_retiredSlots;
+
+			// Indices into m_executors of the executors to run on the next pass.  Once this 
+			// is empty, the thread goes to sleep waiting for someone to be signalled
+			std::vector<size_t> m_readyList;
+			// The pass in progress; swapped with m_readyList so neither is reallocated
+			std::vector<size_t> m_runList;
+			// Executors that returned End on the last pass
+			std::vector<ExecutorID> m_execsToRemove;
 
 			// Map for signalling.  Local only
 			std::unordered_map<ExecutorID, size_t>  m_signalMap;
@@ -160,47 +280,43 @@ namespace holder::base
 			std::vector<ExecutorState> m_executors;
 		};
 
-		// TODO: If lookup by name is too slow, consider introucing a real ID
-
-		// For the sake of simplicity, only new timers are inserted into the priority queue
-		// during processing of updates
-		// Other timers are left alone to fire.
-		// This prevents unexpected upheavals of the queue.
-
-		// To get around this, remove and add a timer.  The old timer will remain in the priority queue
-		// but will be ignored and finally removed when its turn comes.
-
+		// Timers live in a hierarchical timing wheel: WHEEL_LEVELS levels of WHEEL_SLOTS slots,
+		// each slot of level n covering WHEEL_SLOTS^n ticks.  A timer sits in one slot of
+		// the lowest level that can hold its deadline and moves down as the wheel turns.
+		// Setting and cancelling are O(1); everything due in a tick fires as one batch.
+		// Deadlines are rounded up to a whole tick, so a timer may fire up to one tick late
+		// but never early.
+		// A timer with slack fires at the tick within its slack that has the most trailing
+		// zero bits, so that timers whose windows overlap share a tick and a wakeup.
+		// Setting a named timer which already exists reschedules it under the same ID.
 		class TimerThread
 		{
 		private:
-			struct TimerPriorityEntry
-			{
-				std::chrono::time_point<std::chrono::steady_clock> nextBeat;
-				size_t timerIndex;
-
-				bool operator < (const TimerPriorityEntry& other) const
-				{
-					// Priority queues are sorted "largest-first" so we need to reverse the sense
-					return nextBeat > other.nextBeat;
-				}
-			};
+			static constexpr size_t WHEEL_LEVELS = 4;
+			static constexpr size_t WHEEL_SLOT_BITS = 8;
+			static constexpr size_t WHEEL_SLOTS = size_t(1) << WHEEL_SLOT_BITS;
+			static constexpr size_t WHEEL_SLOT_MASK = WHEEL_SLOTS - 1;
+			static constexpr size_t WHEEL_BITMAP_WORDS = WHEEL_SLOTS / 64;
+			static constexpr uint64_t NO_TICK = UINT64_MAX;
+			static constexpr size_t NO_SLOT = SIZE_MAX;
+			// How far back the ticks that timers would have fired at without slack are remembered
+			static constexpr size_t EARLIEST_HISTORY_TICKS = 4096;
 
 			struct TimerStateWrapper
 			{
-				// Set to true when the timer arguments were changed
-				// Currently used to prevent immediate removal of one-shot timers when
-				// they are recalibrated
-				bool recalibrate;
 				TimerDefinition timerDef;
+				TimerID timerID;
+				std::chrono::time_point<std::chrono::steady_clock> nextBeat;
+				uint64_t expiryTick;
+				// Where the timer would have fired without slack
+				uint64_t earliestTick;
+
+				// Links within the wheel slot; slotIndex is level * WHEEL_SLOTS + slot
+				TimerStateWrapper* pPrev{ nullptr };
+				TimerStateWrapper* pNext{ nullptr };
+				size_t slotIndex{ NO_SLOT };
 			};
 
-			enum class TimerAction
-			{
-				Reinsert,
-				Remove
-			};
-
-
 		public:
 			TimerThread();
 
@@ -212,38 +328,177 @@ namespace holder::base
 				unsigned long microInterval,
 				bool repeatingTimer,
 				TimerUserID timerUserID,
-				std::shared_ptr<ITimerCallback> pCallback);
+				std::shared_ptr<ITimerCallback> pCallback,
+				ExecutorID ownerExecutor,
+				unsigned long microSlack);
 			
 			void CancelTimer(const char* pTimerName);
 			void CancelTimer(TimerID timerID);
-		private:
-			void ProcessTimerMessage(const TimerMessage& msg);
 
-			// Called when a timer is "due" in the sense that it is past its deadline
-			// dataLock is provided so the mutex can be unlocked temporarily while 
-			// making the callback
-			TimerAction OnTimerDue(TimerPriorityEntry& timerEntry);
+			TimerStats GetStats() const;
+		private:
+			void ProcessTimerMessage(TimerMessage& msg);
+			void RemoveTimer(std::unordered_map<TimerID, TimerStateWrapper>::iterator itTimer);
+
+			// Wheel operations
+			uint64_t TickOf(std::chrono::time_point<std::chrono::steady_clock> timePoint) const;
+			void ScheduleTimer(TimerStateWrapper& timerState);
+			void InsertIntoWheel(TimerStateWrapper& timerState);
+			void UnlinkFromWheel(TimerStateWrapper& timerState);
+			// Empties a slot and returns its list
+			TimerStateWrapper* DetachSlot(size_t level, size_t slot);
+			// The first tick after the current one at which a slot fires or cascades
+			uint64_t NextEventTick() const;
+			// Turns the wheel up to targetTick, moving due timers to m_dueTimers
+			void AdvanceTo(uint64_t targetTick);
+			// Counts a wakeup for the timers from firstDue on in m_dueTimers
+			void CountWakeup(size_t firstDue);
+
+			// Runs the callbacks for m_dueTimers and reschedules repeating timers.  Timers
+			// owned by an executor are handed to it, one batch per executor
+			void FireDueTimers();
 
 			void operator()();
 
 			std::thread m_thread;
 
 			// NOTE:  This mutex protects ONLY the deque!
-			// However, the wait function uses the top of the priority queue, which is local
+			// The wheel is touched by the timer thread alone
 			std::mutex m_mutexInstructions;
 			std::condition_variable m_cvInstructions;
 
 			std::deque<TimerMessage> m_messages;
 
+			// Nodes of an unordered_map do not move, so the wheel links point into it
 			std::unordered_map<TimerID, TimerStateWrapper> m_timerStates;
-			std::priority_queue<TimerPriorityEntry> m_timerPriorities;
+			std::unordered_map<std::string, TimerID> m_namedTimers;
 			TimerID m_nextTimerIndex{ 0 };
 
+			std::chrono::time_point<std::chrono::steady_clock> m_wheelStart;
+			// Every tick up to and including this one has been fired
+			uint64_t m_currentTick{ 0 };
+			TimerStateWrapper* m_wheel[WHEEL_LEVELS * WHEEL_SLOTS]{};
+			uint64_t m_occupied[WHEEL_LEVELS][WHEEL_BITMAP_WORDS]{};
+			size_t m_slotsInUse{ 0 };
+			std::vector<TimerStateWrapper*> m_dueTimers;
+			std::unordered_map<ExecutorID, std::vector<ExpiredTimer> > m_deliveries;
+			// Ticks at which timers would have fired without slack, as a ring of bits ending at
+			// m_historyTick
+			uint64_t m_earliestHistory[EARLIEST_HISTORY_TICKS / 64]{};
+			uint64_t m_historyTick{ 0 };
+
+			// Written by the timer thread only
+			std::atomic<uint64_t> m_wakeups{ 0 };
+			std::atomic<uint64_t> m_wakeupsWithoutSlack{ 0 };
+			std::atomic<size_t> m_activeTimers{ 0 };
+			std::atomic<size_t> m_publishedSlotsInUse{ 0 };
+			std::array<std::atomic<uint64_t>, TimerStats::HISTOGRAM_BUCKETS> m_lateness{};
+			std::array<std::atomic<uint64_t>, TimerStats::HISTOGRAM_BUCKETS> m_callbackDuration{};
+
 			// Atomic here
-			std::atomic<bool>  m_threadDoomed;
+			std::atomic<bool>  m_threadDoomed{ false };
 		};
 
 
+		// Pool mode: executors that are not singletons are not pinned to their named thread but
+		// run on a fixed set of workers.  Each worker has its own run queue and steals from the
+		// others when it runs dry.  An executor is in at most one queue, or on one worker, at
+		// any time, so its calls are serialized just as on an ExecutorThread
+		class ExecutorPool
+		{
+		private:
+			enum class PooledStateTag
+			{
+				Suspended,
+				Queued,
+				Running,
+				// Signalled while running: queued again even if Run() asks to suspend
+				RunningSignalled
+			};
+
+			struct PooledExecutor
+			{
+				ExecutorID execId;
+				// The name it was added under; reported by GetCurrentThreadName() while it runs,
+				// so in the pool a name no longer stands for one thread
+				std::string threadName;
+				std::shared_ptr<IExecutor> pExecutor;
+				std::atomic<PooledStateTag> stateTag{ PooledStateTag::Queued };
+				std::atomic<bool> terminationRequested{ false };
+				// Only touched by the worker running it
+				bool initialized{ false };
+
+				// Delivered by the timer thread; run before the next Run()
+				std::mutex mutexTimers;
+				std::vector<ExpiredTimer> expiredTimers;
+				std::atomic<bool> timersPending{ false };
+
+				PooledExecutor(ExecutorID execId_,
+					const std::string& threadName_,
+					std::shared_ptr<IExecutor> pExecutor_)
+					:execId(execId_),
+					threadName(threadName_),
+					pExecutor(std::move(pExecutor_))
+				{ }
+			};
+
+			struct Worker
+			{
+				std::mutex mutexQueue;
+				std::deque<PooledExecutor*> runQueue;
+				std::thread thread;
+			};
+
+		public:
+			ExecutorPool(size_t workerCount);
+
+			void StartMe();
+			void JoinMe();
+			// Once doomed, the workers end when the last executor has
+			void DoomMe();
+
+			void PostAddExecutor(ExecutorID execId,
+				const std::string& threadName,
+				std::shared_ptr<IExecutor> pExecutor);
+			void PostSignalExecutor(ExecutorID execId,
+				ExecutorSignalType signalType);
+			void PostSignalAll(ExecutorSignalType signalType);
+			// False if the executor is not in the pool
+			bool PostTimers(ExecutorID execId, std::vector<ExpiredTimer>& expiredTimers);
+
+		private:
+			void operator()(size_t workerIdx);
+
+			void SignalPooled(PooledExecutor& rPooled, ExecutorSignalType signalType);
+			void Schedule(PooledExecutor* pPooled, size_t workerIdx);
+			// Own queue first, then the others'
+			PooledExecutor* TakeWork(size_t workerIdx);
+			void RunPooled(PooledExecutor* pPooled, size_t workerIdx);
+			void RemovePooled(PooledExecutor* pPooled);
+			bool IsFinished() const;
+
+			size_t m_workerCount;
+			std::unique_ptr<Worker[]> m_workers;
+			// Where executors signalled from outside the pool go
+			std::atomic<size_t> m_nextWorker{ 0 };
+
+			// Owns the executors.  Signallers hold it shared, so an executor cannot be
+			// removed while it is being signalled
+			std::shared_mutex m_mutexExecutors;
+			std::unordered_map<ExecutorID, std::unique_ptr<PooledExecutor> > m_executors;
+			std::atomic<size_t> m_executorCount{ 0 };
+
+			// Sleeping workers
+			std::mutex m_mutexIdle;
+			std::condition_variable m_cvIdle;
+			std::atomic<size_t> m_queuedCount{ 0 };
+			std::atomic<size_t> m_idleWorkers{ 0 };
+			std::atomic<bool> m_isDoomed{ false };
+			std::atomic<size_t> m_runningWorkers{ 0 };
+		};
+
+		friend struct ExecutorSignalSlot;
+
 	public:
 		static ExecutionManager& GetInstance();
 		static const std::string& GetCurrentThreadName()
@@ -251,7 +506,12 @@ namespace holder::base
 			return m_tlThreadName;
 		}
 
-		ExecutorID AddExecutor(const char* pThreadName,
+		// Applies to the thread when it is created by a later AddExecutor.  Returns false if a thread
+		// of that name already exists
+		bool ConfigureThread(const char* pThreadName, const ExecutorThreadOptions& options);
+
+		// The handle is invalid if the shop is locked
+		ExecutorHandle AddExecutor(const char* pThreadName,
 			const std::shared_ptr<IExecutor>& pExecutor,
 			bool isSingleton = false);
 
@@ -263,31 +523,50 @@ namespace holder::base
 		// for new executors when its executors run out
 		void DoomThread(const char* pThreadName);
 
+		// True only if the two can never run at the same time: the same executor, or two
+		// on one named thread.  Never for two pooled executors, whatever their names
+		bool AreOnSameThread(ExecutorID executorIdA, ExecutorID executorIdB);
+
 		bool SignalExecutor(ExecutorID executorId, ExecutorSignalType signalType);
+		// Lock-free for executors on named threads
+		bool SignalExecutor(const ExecutorHandle& handle, ExecutorSignalType signalType);
 
 		// Wait for all threads to terminate -- the "run loop"
 		// Returns when all threads are joinable.
 		void RunLoop(std::chrono::microseconds wakeUpTime);
 
 		// Timer creation
+		// A timer owned by an executor runs its callback on the executor's thread, just before
+		// the executor runs; timers due together reach it in one batch.  The timer is dropped
+		// when the executor is gone.  Without an owner the callback runs on the timer thread.
+		// microSlack lets the timer fire up to that much late, so that it can share a wakeup
+		// with others
 		bool SetTimer(const char* pTimerName,
 			unsigned long microInterval,
 			bool repeatingTimer,
-			TimerID timerID,
-			std::shared_ptr<ITimerCallback> pCallback);
+			TimerUserID timerUserID,
+			std::shared_ptr<ITimerCallback> pCallback,
+			ExecutorID ownerExecutor = EXEC_WILDCARD,
+			unsigned long microSlack = 0);
 
 		void CancelTimer(const char* pTimerName);
 		void CancelTimer(TimerID timerID);
 
+		TimerStats GetTimerStats() const;
+
 	private:
 		ExecutionManager();
 		~ExecutionManager();
 
-		const std::chrono::microseconds& GetIdleTimeout() const { return m_idleTimeout; }
 		// Called only by inner-class objects
 		void RemoveThread(ThreadID threadId);
 		void RemoveExecutors(const std::vector<ExecutorID>& toRemove);
+		void RemovePool();
 		void LockedShopUpdateState();
+		// Hands expired timers to their executor.  False, and expiredTimers untouched, if the
+		// executor is gone
+		bool DeliverTimers(ExecutorID ownerExecutor, std::vector<ExpiredTimer>& expiredTimers);
+		bool HasThreads() const { return !m_threadMap.empty() || m_poolRunning; }
 
 		// TODO:  Since "signal" may be called quite often, is there a better way to associate
 		// executor IDs to threads?
@@ -299,14 +578,21 @@ namespace holder::base
 		std::unordered_map<ExecutorID, ThreadID> m_executorMap;
 		std::unordered_map<std::string, ThreadID>  m_threadNameMap;
 		std::unordered_map<ThreadID, std::shared_ptr<ExecutorThread> >  m_threadMap;
+		std::unordered_map<std::string, ExecutorThreadOptions> m_threadOptions;
 
 		std::unique_ptr<TimerThread> m_pTimerThread;
 
+		// Zero: every executor gets its named thread
+		size_t m_poolWorkerCount{ 0 };
+		std::unique_ptr<ExecutorPool> m_pPool;
+		bool m_poolRunning{ false };
+		// Stands in for a ThreadID in m_executorMap
+		static constexpr ThreadID POOL_THREAD_ID = SIZE_MAX;
+
 		ThreadID m_nextThread{ 0 };
 		ExecutorID m_nextExec{ 0 };
 
 		bool m_lockedShop{ false };
-		std::chrono::microseconds m_idleTimeout;
 
 		std::vector<std::shared_ptr<ExecutorThread> >  m_threadsToJoin;
 
@@ -11,6 +11,10 @@ namespace holder::base
 	// For anonymous timers this is how the timer is identified
 	using TimerID = uint32_t;
 
+	using ExecutorID = uint32_t;
+
+	constexpr ExecutorID EXEC_WILDCARD = 0xffffffff;
+
 	enum class ExecutionState
 	{
 		Continue,
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <new>
+#include <cstddef>
+
+namespace holder::lib
+{
+
+	// A bounded lock-free ring for many producers and exactly one consumer
+	// Every cell carries a sequence number; a producer claims a cell by advancing the enqueue
+	// position with a CAS, and publishes it by bumping the cell's sequence.  The consumer is
+	// the only one who moves the dequeue position, so it needs no atomics of its own.
+	// When the ring is full TryPush fails and leaves the value alone; what to do then is up
+	// to the caller
+	template<typename T>
+	class MPSCRing
+	{
+	private:
+		static constexpr size_t CACHE_LINE = 64;
+
+		struct Cell
+		{
+			std::atomic<size_t> sequence;
+			alignas(T) unsigned char storage[sizeof(T)];
+
+			T* GetValue()
+			{
+				return std::launder(reinterpret_cast<T*>(storage));
+			}
+		};
+
+		static size_t RoundUpCapacity(size_t capacity)
+		{
+			size_t rounded{ 2 };
+			while (rounded < capacity)
+			{
+				rounded <<= 1;
+			}
+			return rounded;
+		}
+
+	public:
+		MPSCRing(const MPSCRing&) = delete;
+		MPSCRing& operator=(const MPSCRing&) = delete;
+
+		explicit MPSCRing(size_t capacity)
+			:m_mask(RoundUpCapacity(capacity) - 1),
+			m_cells(new Cell[m_mask + 1])
+		{
+			for (size_t i = 0; i <= m_mask; ++i)
+			{
+				m_cells[i].sequence.store(i, std::memory_order_relaxed);
+			}
+		}
+
+		~MPSCRing()
+		{
+			// Destroy whatever was never consumed
+			while (TryConsume([](T&&) { }));
+		}
+
+		size_t GetCapacity() const { return m_mask + 1; }
+
+		// Any thread.  The value is moved from only on success
+		bool TryPush(T&& value)
+		{
+			size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+			Cell* pCell;
+
+			while (true)
+			{
+				pCell = &m_cells[pos & m_mask];
+				size_t seq = pCell->sequence.load(std::memory_order_acquire);
+				auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+
+				if (diff == 0)
+				{
+					if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					{
+						break;
+					}
+				}
+				else if (diff < 0)
+				{
+					// Full
+					return false;
+				}
+				else
+				{
+					pos = m_enqueuePos.load(std::memory_order_relaxed);
+				}
+			}
+
+			new (pCell->storage) T(std::move(value));
+			pCell->sequence.store(pos + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Consumer thread only.  Hands the oldest published value to the sink
+		template<typename Sink>
+		bool TryConsume(Sink&& sink)
+		{
+			Cell* pCell = &m_cells[m_dequeuePos & m_mask];
+			size_t seq = pCell->sequence.load(std::memory_order_acquire);
+
+			if (seq != m_dequeuePos + 1)
+			{
+				// Empty, or the producer who claimed this cell has not published it yet
+				return false;
+			}
+
+			T* pValue = pCell->GetValue();
+			sink(std::move(*pValue));
+			pValue->~T();
+
+			pCell->sequence.store(m_dequeuePos + m_mask + 1, std::memory_order_release);
+			++m_dequeuePos;
+			return true;
+		}
+
+	private:
+		const size_t m_mask;
+		std::unique_ptr<Cell[]> m_cells;
+
+		// Producers hammer the enqueue position; keep it away from the consumer's data
+		alignas(CACHE_LINE) std::atomic<size_t> m_enqueuePos{ 0 };
+		alignas(CACHE_LINE) size_t m_dequeuePos{ 0 };
+	};
+
+}
@@ -4,9 +4,13 @@
 
 namespace impl_ns = holder::messages;
 
-impl_ns::MQDExecutor::MQDExecutor(const char* pthreadName, bool traceLostMessages)
-	:MessageDequeDispatcher(traceLostMessages),
-	m_threadName(pthreadName)
+impl_ns::MQDExecutor::MQDExecutor(const char* pthreadName, const MQDOptions& options,
+	const base::ExecutorThreadOptions& threadOptions)
+	:MessageDequeDispatcher(options),
+	m_threadName(pthreadName),
+	m_threadOptions(threadOptions),
+	m_quantumMessages(options.quantumMessages),
+	m_quantumTime(options.quantumTime)
 { }
 
 void impl_ns::MQDExecutor::InitExecutor()
@@ -15,14 +19,28 @@ void impl_ns::MQDExecutor::InitExecutor()
 	{
 		auto pMyBase = GetExecutorSharedPtr();
 
-		m_myExecutor.store(base::ExecutionManager::GetInstance().AddExecutor(m_threadName.c_str(),
-			pMyBase));
+		if (!m_threadOptions.IsDefault())
+		{
+			// Has no effect if the thread is already running, e.g. for another executor
+			base::ExecutionManager::GetInstance().ConfigureThread(m_threadName.c_str(), m_threadOptions);
+		}
+
+		m_myHandle = base::ExecutionManager::GetInstance().AddExecutor(m_threadName.c_str(),
+			pMyBase);
+		SetConsumerPinned(!m_myHandle.IsPooled());
+		m_myExecutor.store(m_myHandle.GetExecutorID());
 	}
 }
 
 holder::base::ExecutionState impl_ns::MQDExecutor::Run(holder::base::ExecutionArgs& args)
 {
-	WorkStateDescription queueWork{ 0,0 };
+	// Bounded by the quantum, so that other executors on this thread get their turn.
+	// Whatever is left over makes us return Continue and come around again
+	WorkStateDescription queueWork{ m_quantumMessages, 0 };
+	if (m_quantumTime.count() > 0)
+	{
+		queueWork.deadline = std::chrono::steady_clock::now() + m_quantumTime;
+	}
 	MessageDequeDispatcher::ProcessMessages(queueWork);
 
 	if (m_endRequested)
@@ -31,7 +49,8 @@ holder::base::ExecutionState impl_ns::MQDExecutor::Run(holder::base::ExecutionAr
 		return base::ExecutionState::End;
 	}
 
-	if (queueWork.msgsRemaining > 0)
+	if (queueWork.msgsRemaining > 0
+		|| MessageDequeDispatcher::RearmSignal())
 	{
 		return base::ExecutionState::Continue;
 	}
@@ -46,11 +65,19 @@ void impl_ns::MQDExecutor::TerminationRequested()
 
 void impl_ns::MQDExecutor::DoSignal()
 {
-	base::ExecutionManager::GetInstance().SignalExecutor(m_myExecutor.load(), base::ExecutorSignalType::WakeUp);
+	if (m_myExecutor.load() != base::EXEC_WILDCARD)
+	{
+		base::ExecutionManager::GetInstance().SignalExecutor(m_myHandle, base::ExecutorSignalType::WakeUp);
+	}
 }
 
 bool impl_ns::MQDExecutor::Init()
 {
+	// Runs on the executor thread, which is already pinned
+	if (m_threadOptions.HasPlacement())
+	{
+		MessageDequeDispatcher::ReserveOnConsumerThread(CONSUMER_RESERVE);
+	}
 	return true;
 }
 void impl_ns::MQDExecutor::DeInit()
@@ -59,7 +86,23 @@ void impl_ns::MQDExecutor::DeInit()
 }
 
 // DefaultMQDExecutor
-std::tuple<std::string, bool> impl_ns::DefaultMQDExecutor::Unpacker::Unpack(const data::IDatum& datum)
+namespace
+{
+	// Optional keys keep their default when absent, but a malformed value is still an error
+	template<typename T>
+	void UnpackOptional(const holder::data::IDatum& datum, const char* pKey, T& value)
+	{
+		auto accessResult = holder::data::GetDictValue<T>(datum, pKey, value);
+		if (accessResult != holder::data::AccessResult::OK
+			&& accessResult != holder::data::AccessResult::NoSuchElement)
+		{
+			throw holder::base::UnpackArgumentsException();
+		}
+	}
+}
+
+std::tuple<std::string, impl_ns::MQDOptions, holder::base::ExecutorThreadOptions> 
+	impl_ns::DefaultMQDExecutor::Unpacker::Unpack(const data::IDatum& datum)
 {
 	std::string threadName;
 	if (data::GetDictValue<std::string>(datum, "threadName", threadName)
@@ -68,12 +111,153 @@ std::tuple<std::string, bool> impl_ns::DefaultMQDExecutor::Unpacker::Unpack(cons
 		throw holder::base::UnpackArgumentsException();
 	}
 
-	bool traceLostMessages;
-	if (data::GetDictValue<bool>(datum, "traceLostMessages", traceLostMessages)
+	MQDOptions options;
+	if (data::GetDictValue<bool>(datum, "traceLostMessages", options.traceLostMessages)
 		!= data::AccessResult::OK)
 	{
 		throw holder::base::UnpackArgumentsException();
 	}
 
-	return std::make_tuple(threadName, traceLostMessages);
+	// "deque" (the default) or "ring"
+	std::string queueType;
+	UnpackOptional<std::string>(datum, "queueType", queueType);
+	if (queueType == "ring")
+	{
+		options.queueType = MQDQueueType::LockFreeRing;
+	}
+	else if (!queueType.empty() && queueType != "deque")
+	{
+		throw holder::base::UnpackArgumentsException();
+	}
+
+	uint32_t ringCapacity{ 0 };
+	UnpackOptional<uint32_t>(datum, "ringCapacity", ringCapacity);
+	if (ringCapacity > 0)
+	{
+		options.ringCapacity = ringCapacity;
+	}
+
+	uint32_t laneCount{ 0 };
+	UnpackOptional<uint32_t>(datum, "laneCount", laneCount);
+	if (laneCount > 0)
+	{
+		options.laneCount = laneCount;
+	}
+
+	// Optional list of per-lane drain weights, lane 0 first
+	std::shared_ptr<data::IListDatum> pWeights;
+	auto weightsResult = data::GetDictChild<data::IListDatum>(datum, "laneWeights", pWeights);
+	if (weightsResult == data::AccessResult::OK)
+	{
+		for (size_t laneIdx = 0; laneIdx < pWeights->GetLength(); ++laneIdx)
+		{
+			uint32_t weight{ 0 };
+			if (data::GetListValue<uint32_t>(*pWeights, laneIdx, weight) != data::AccessResult::OK)
+			{
+				throw holder::base::UnpackArgumentsException();
+			}
+			options.laneWeights.push_back(weight);
+		}
+	}
+	else if (weightsResult != data::AccessResult::NoSuchElement)
+	{
+		throw holder::base::UnpackArgumentsException();
+	}
+
+	uint32_t quantumMessages{ 0 };
+	UnpackOptional<uint32_t>(datum, "quantumMessages", quantumMessages);
+	options.quantumMessages = quantumMessages;
+
+	uint32_t quantumMicroseconds{ 0 };
+	UnpackOptional<uint32_t>(datum, "quantumMicroseconds", quantumMicroseconds);
+	options.quantumTime = std::chrono::microseconds(quantumMicroseconds);
+
+	uint32_t receiverQuantum{ 0 };
+	UnpackOptional<uint32_t>(datum, "receiverQuantum", receiverQuantum);
+	options.receiverQuantum = receiverQuantum;
+
+	uint32_t capacity{ 0 };
+	UnpackOptional<uint32_t>(datum, "softCapacity", capacity);
+	options.softCapacity = capacity;
+
+	capacity = 0;
+	UnpackOptional<uint32_t>(datum, "hardCapacity", capacity);
+	options.hardCapacity = capacity;
+
+	capacity = 0;
+	UnpackOptional<uint32_t>(datum, "receiverSoftCapacity", capacity);
+	options.receiverSoftCapacity = capacity;
+
+	capacity = 0;
+	UnpackOptional<uint32_t>(datum, "receiverHardCapacity", capacity);
+	options.receiverHardCapacity = capacity;
+
+	// Zero turns it off
+	uint32_t timeInQueueSampling{ static_cast<uint32_t>(options.timeInQueueSampling) };
+	UnpackOptional<uint32_t>(datum, "timeInQueueSampling", timeInQueueSampling);
+	options.timeInQueueSampling = timeInQueueSampling;
+
+	UnpackOptional<bool>(datum, "sameThreadDelivery", options.sameThreadDelivery);
+
+	uint32_t sameThreadBudget{ 0 };
+	UnpackOptional<uint32_t>(datum, "sameThreadBudget", sameThreadBudget);
+	if (sameThreadBudget > 0)
+	{
+		options.sameThreadBudget = sameThreadBudget;
+	}
+
+	// "block", "dropOldest", "dropNewest" or "reject" (the default)
+	std::string overflowPolicy;
+	UnpackOptional<std::string>(datum, "overflowPolicy", overflowPolicy);
+	if (overflowPolicy == "block")
+	{
+		options.overflowPolicy = MQDOverflowPolicy::Block;
+	}
+	else if (overflowPolicy == "dropOldest")
+	{
+		options.overflowPolicy = MQDOverflowPolicy::DropOldest;
+	}
+	else if (overflowPolicy == "dropNewest")
+	{
+		options.overflowPolicy = MQDOverflowPolicy::DropNewest;
+	}
+	else if (!overflowPolicy.empty() && overflowPolicy != "reject")
+	{
+		throw holder::base::UnpackArgumentsException();
+	}
+
+	// Thread placement: an explicit list of CPUs, or a NUMA node whose CPUs to use
+	base::ExecutorThreadOptions threadOptions;
+	std::shared_ptr<data::IListDatum> pCpus;
+	auto cpusResult = data::GetDictChild<data::IListDatum>(datum, "cpus", pCpus);
+	if (cpusResult == data::AccessResult::OK)
+	{
+		for (size_t cpuIdx = 0; cpuIdx < pCpus->GetLength(); ++cpuIdx)
+		{
+			uint32_t cpu{ 0 };
+			if (data::GetListValue<uint32_t>(*pCpus, cpuIdx, cpu) != data::AccessResult::OK)
+			{
+				throw holder::base::UnpackArgumentsException();
+			}
+			threadOptions.cpuSet.push_back(cpu);
+		}
+	}
+	else if (cpusResult != data::AccessResult::NoSuchElement)
+	{
+		throw holder::base::UnpackArgumentsException();
+	}
+
+	// Busy-wait this long for new messages before parking the thread
+	uint32_t spinMicroseconds{ 0 };
+	UnpackOptional<uint32_t>(datum, "spinMicroseconds", spinMicroseconds);
+	threadOptions.spinBudget = std::chrono::microseconds(spinMicroseconds);
+
+	uint32_t numaNode{ UINT32_MAX };
+	UnpackOptional<uint32_t>(datum, "numaNode", numaNode);
+	if (numaNode != UINT32_MAX)
+	{
+		threadOptions.numaNode = static_cast<int>(numaNode);
+	}
+
+	return std::make_tuple(threadName, options, threadOptions);
 }
@@ -22,11 +22,13 @@ namespace holder::messages
 		void TerminationRequested() override;
 		bool Init() override;
 		void DeInit() override;
+
+		base::ExecutorID GetExecutorID() const override { return m_myExecutor.load(); }
 	protected:
-		MQDExecutor(const char* pThreadName, bool traceLostMessages);
+		MQDExecutor(const char* pThreadName, const MQDOptions& options,
+			const base::ExecutorThreadOptions& threadOptions = base::ExecutorThreadOptions());
 		void InitExecutor();
 		void DoSignal() override;
-		base::ExecutorID GetExecutorID() const { return m_myExecutor.load(); }
 
 		const char* GetExecutionThreadName() const override { return m_threadName.c_str(); }
 
@@ -34,7 +36,15 @@ namespace holder::messages
 			GetExecutorSharedPtr() = 0;
 
 	private:
+		// Room per lane that Init() reserves on a placed thread
+		static constexpr size_t CONSUMER_RESERVE = 256;
+
 		std::string m_threadName;
+		base::ExecutorThreadOptions m_threadOptions;
+		size_t m_quantumMessages{ 0 };
+		std::chrono::microseconds m_quantumTime{ 0 };
+		// Published through m_myExecutor, which is stored after it
+		base::ExecutorHandle m_myHandle;
 		std::atomic<base::ExecutorID> m_myExecutor{ base::EXEC_WILDCARD };
 		bool m_endRequested{ false };
 	};
@@ -45,10 +55,11 @@ namespace holder::messages
 	public:
 		struct Unpacker
 		{
-			static std::tuple<std::string, bool> Unpack(const data::IDatum& datum);
+			static std::tuple<std::string, MQDOptions, base::ExecutorThreadOptions> Unpack(const data::IDatum& datum);
 		};
 
-		DefaultMQDExecutor(const std::string& strName, bool traceLostMessages);
+		DefaultMQDExecutor(const std::string& strName, const MQDOptions& options,
+			const base::ExecutorThreadOptions& threadOptions = base::ExecutorThreadOptions());
 
 		const std::shared_ptr<IExecutor>&
 			GetExecutorSharedPtr() override;
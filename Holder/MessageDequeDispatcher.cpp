@@ -1,10 +1,61 @@
 #include "MessageDequeDispatcher.h"
+#include "RaiiLambda.h"
 
+#include <algorithm>
+#include <iostream>
 #include <limits>
 
 namespace impl_ns = holder::messages;
 namespace msg_ns = holder::messages;
 
+namespace
+{
+	// The dispatcher whose ProcessMessages is running on this thread, if any
+	thread_local const holder::messages::MessageDequeDispatcher* tl_pProcessingDispatcher{ nullptr };
+
+	// Adds count unless that takes the size past the limit (zero for none).  An empty queue
+	// always takes it, so that a batch larger than the limit can still get through
+	bool TryAddSize(std::atomic<size_t>& rSize, size_t count, size_t limit, size_t& rNewSize)
+	{
+		size_t size = rSize.load();
+		do
+		{
+			if (limit > 0 && size > 0 && size + count > limit)
+			{
+				return false;
+			}
+		} while (!rSize.compare_exchange_weak(size, size + count));
+
+		rNewSize = size + count;
+		return true;
+	}
+
+	// For counters with a single writer
+	void BumpCounter(std::atomic<uint64_t>& rCounter, uint64_t count = 1)
+	{
+		rCounter.store(rCounter.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+	}
+
+	uint32_t GetMicrosecondStamp()
+	{
+		auto sinceEpoch = std::chrono::steady_clock::now().time_since_epoch();
+		return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(sinceEpoch).count());
+	}
+
+	bool TakeDropDebt(std::atomic<size_t>& rDebt)
+	{
+		size_t debt = rDebt.load(std::memory_order_relaxed);
+		while (debt > 0)
+		{
+			if (rDebt.compare_exchange_weak(debt, debt - 1, std::memory_order_relaxed))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+}
+
 /*
 bool impl_ns::MessageDequeDispatcher::MQDSenderEndpoint::SendMessage(const std::shared_ptr<IMessage>& pMsg)
 {
@@ -22,11 +73,615 @@ bool impl_ns::MessageDequeDispatcher::MQDSenderEndpoint::SendMessage(const std::
 }
 */
 
-void impl_ns::MessageDequeDispatcher::SendMessage(ReceiverID rcvrId, std::shared_ptr<IMessage> pMessage)
+impl_ns::MessageDequeDispatcher::MessageDequeDispatcher(const MQDOptions& options)
+	:m_laneCount(options.laneCount > 0 ? options.laneCount : 1),
+	m_softCapacity(options.softCapacity),
+	m_hardCapacity(options.hardCapacity),
+	m_receiverSoftCapacity(options.receiverSoftCapacity),
+	m_receiverHardCapacity(options.receiverHardCapacity),
+	m_overflowPolicy(options.overflowPolicy),
+	m_receiverQuantum(options.receiverQuantum),
+	m_sameThreadDelivery(options.sameThreadDelivery),
+	m_sameThreadBudget(options.sameThreadBudget),
+	m_traceLostMessages(options.traceLostMessages)
+{
+	m_lanes = std::make_unique<Lane_[]>(m_laneCount);
+
+	m_receiverLimited = m_receiverSoftCapacity > 0 || m_receiverHardCapacity > 0;
+	m_limited = m_receiverLimited || m_softCapacity > 0 || m_hardCapacity > 0;
+	m_receiverLoads = std::make_unique<std::atomic<ReceiverLoad_*>[]>(MAX_LOAD_CHUNKS);
+
+	if (options.timeInQueueSampling > 0)
+	{
+		uint32_t interval{ 1 };
+		while (interval < options.timeInQueueSampling && interval < (1u << 31))
+		{
+			interval <<= 1;
+		}
+		m_sampleTimeInQueue = true;
+		m_sampleMask = interval - 1;
+	}
+
+	size_t defaultWeight{ 1 };
+	for (size_t laneIdx = 0; laneIdx < m_laneCount; ++laneIdx)
+	{
+		Lane_& lane = m_lanes[laneIdx];
+
+		if (m_laneCount == 1)
+		{
+			// Nothing to share with
+			lane.weight = std::numeric_limits<size_t>::max();
+		}
+		else if (laneIdx < options.laneWeights.size() && options.laneWeights[laneIdx] > 0)
+		{
+			lane.weight = options.laneWeights[laneIdx];
+		}
+		else
+		{
+			lane.weight = defaultWeight;
+		}
+		defaultWeight = lane.weight < std::numeric_limits<size_t>::max() / 4 ? lane.weight * 4 : lane.weight;
+
+		if (options.queueType == MQDQueueType::LockFreeRing)
+		{
+			lane.pRing = std::make_unique<lib::MPSCRing<MQDMessageEnvelope> >(options.ringCapacity);
+		}
+	}
+}
+
+msg_ns::SendResult impl_ns::MessageDequeDispatcher::SendMessage(ReceiverID rcvrId, 
+	std::shared_ptr<IMessage> pMessage)
+{
+	// Skip the virtual call when there is only one lane anyway
+	MessagePriority priority = m_laneCount > 1 ? pMessage->GetPriority() : PRIORITY_NORMAL;
+	return SendMessage(rcvrId, std::move(pMessage), priority);
+}
+
+msg_ns::SendResult impl_ns::MessageDequeDispatcher::SendMessage(ReceiverID rcvrId, 
+	std::shared_ptr<IMessage> pMessage,
+	MessagePriority priority)
+{
+	size_t laneIdx = GetLaneIndex(priority);
+
+	size_t dropCount{ 0 };
+	SendResult result = ReserveCapacity(rcvrId, 1, dropCount);
+	if (!IsQueued(result))
+	{
+		return result;
+	}
+	if (dropCount > 0)
+	{
+		m_lanes[laneIdx].dropDebt.fetch_add(dropCount, std::memory_order_relaxed);
+	}
+
+	MQDMessageEnvelope envelope(rcvrId, std::move(pMessage), GetEnqueueStamp());
+	Lane_& lane = m_lanes[laneIdx];
+
+	if (UseSameThreadPath(1, lane.sameThreadSpill))
+	{
+		lane.localQueue.emplace_back(std::move(envelope));
+		return result;
+	}
+
+	{
+		std::unique_lock lkQueue(m_mutexQueue, std::defer_lock);
+		EnqueueMessage(laneIdx, std::move(envelope), lkQueue);
+	}
+
+	if (IsSendingFromHandler())
+	{
+		lane.sameThreadSpill = true;
+	}
+
+	if (laneIdx > 0)
+	{
+		m_priorityPending.store(true, std::memory_order_release);
+	}
+	SignalIfArmed();
+	return result;
+}
+
+void impl_ns::MessageDequeDispatcher::EnqueueMessage(size_t laneIdx, 
+	MQDMessageEnvelope&& envelope,
+	std::unique_lock<std::mutex>& lkQueue)
+{
+	Lane_& lane = m_lanes[laneIdx];
+
+	if (lane.pRing 
+		&& !lane.ringOverflow.load(std::memory_order_acquire)
+		&& lane.pRing->TryPush(std::move(envelope)))
+	{
+		return;
+	}
+
+	if (!lkQueue.owns_lock())
+	{
+		lkQueue.lock();
+	}
+
+	if (lane.pRing)
+	{
+		// The ring is full (or was recently); spill into the locked queue
+		lane.ringOverflow.store(true, std::memory_order_release);
+	}
+	lane.queue.emplace_back(std::move(envelope));
+}
+
+msg_ns::SendResult impl_ns::MessageDequeDispatcher::SendMessages(ReceiverID rcvrId, MessageSpan messages)
+{
+	return SendBatch(rcvrId, messages, std::nullopt);
+}
+
+msg_ns::SendResult impl_ns::MessageDequeDispatcher::SendMessages(ReceiverID rcvrId, MessageSpan messages,
+	MessagePriority priority)
+{
+	return SendBatch(rcvrId, messages, priority);
+}
+
+msg_ns::SendResult impl_ns::MessageDequeDispatcher::SendBatch(ReceiverID rcvrId, MessageSpan messages,
+	std::optional<MessagePriority> priority)
+{
+	if (messages.empty())
+	{
+		return SendResult::Queued;
+	}
+
+	size_t dropCount{ 0 };
+	SendResult result = ReserveCapacity(rcvrId, messages.size(), dropCount);
+	if (!IsQueued(result))
+	{
+		return result;
+	}
+
+	bool spillPending{ false };
+	bool fromHandler = IsSendingFromHandler();
+	if (fromHandler)
+	{
+		// Not worth finding out which lanes the batch goes to
+		for (size_t laneIdx = 0; laneIdx < m_laneCount; ++laneIdx)
+		{
+			spillPending = spillPending || m_lanes[laneIdx].sameThreadSpill;
+		}
+	}
+
+	bool sameThread = UseSameThreadPath(messages.size(), spillPending);
+	bool anyPriority{ false };
+	{
+		// Taken at most once, and only when some message cannot go into a ring
+		std::unique_lock lkQueue(m_mutexQueue, std::defer_lock);
+		for (const std::shared_ptr<IMessage>& pMessage : messages)
+		{
+			size_t laneIdx = m_laneCount > 1 
+				? GetLaneIndex(priority.has_value() ? priority.value() : pMessage->GetPriority())
+				: 0;
+			anyPriority = anyPriority || laneIdx > 0;
+			if (dropCount > 0)
+			{
+				// Charged one per message, so no lane owes more than it was sent
+				m_lanes[laneIdx].dropDebt.fetch_add(1, std::memory_order_relaxed);
+				--dropCount;
+			}
+
+			MQDMessageEnvelope envelope(rcvrId, pMessage, GetEnqueueStamp());
+			if (sameThread)
+			{
+				m_lanes[laneIdx].localQueue.emplace_back(std::move(envelope));
+			}
+			else
+			{
+				EnqueueMessage(laneIdx, std::move(envelope), lkQueue);
+				if (fromHandler)
+				{
+					m_lanes[laneIdx].sameThreadSpill = true;
+				}
+			}
+		}
+	}
+
+	if (sameThread)
+	{
+		return result;
+	}
+
+	if (anyPriority)
+	{
+		m_priorityPending.store(true, std::memory_order_release);
+	}
+	SignalIfArmed();
+	return result;
+}
+
+msg_ns::SendResult impl_ns::MessageDequeDispatcher::ReserveCapacity(ReceiverID rcvrId, 
+	size_t count, 
+	size_t& rDropCount)
+{
+	rDropCount = 0;
+	if (!m_limited)
+	{
+		m_totalSize += count;
+		return SendResult::Queued;
+	}
+
+	ReceiverLoad_* pLoad = m_receiverLimited ? GetReceiverLoad(rcvrId) : nullptr;
+	// DropOldest lets the queues run past capacity until the consumer gets to the discards
+	size_t slack = m_overflowPolicy == MQDOverflowPolicy::DropOldest ? 2 : 1;
+	size_t newSize{ 0 };
+	size_t newReceiverSize{ 0 };
+
+	if (!TryReserve(pLoad, count, slack, newSize, newReceiverSize))
+	{
+		switch (m_overflowPolicy)
+		{
+		case MQDOverflowPolicy::Block:
+			if (IsConsumerThread())
+			{
+				// We would be waiting for ourselves
+				m_msgsRejected.fetch_add(count, std::memory_order_relaxed);
+				return SendResult::Rejected;
+			}
+			{
+				std::unique_lock lkSpace(m_mutexSpace);
+				++m_blockedSenders;
+				m_cvSpace.wait(lkSpace, [&]()
+					{
+						return TryReserve(pLoad, count, slack, newSize, newReceiverSize);
+					});
+				--m_blockedSenders;
+			}
+			break;
+		case MQDOverflowPolicy::DropOldest:
+		case MQDOverflowPolicy::DropNewest:
+			m_msgsDroppedNewest.fetch_add(count, std::memory_order_relaxed);
+			return SendResult::DroppedNewest;
+		case MQDOverflowPolicy::Reject:
+			m_msgsRejected.fetch_add(count, std::memory_order_relaxed);
+			return SendResult::Rejected;
+		}
+	}
+
+	SendResult result{ SendResult::Queued };
+	if (m_overflowPolicy == MQDOverflowPolicy::DropOldest)
+	{
+		size_t receiverExcess = pLoad && m_receiverHardCapacity > 0 && newReceiverSize > m_receiverHardCapacity
+			? std::min(count, newReceiverSize - m_receiverHardCapacity) : 0;
+		size_t excess = m_hardCapacity > 0 && newSize > m_hardCapacity
+			? std::min(count, newSize - m_hardCapacity) : 0;
+
+		if (receiverExcess > 0)
+		{
+			pLoad->dropDebt.fetch_add(receiverExcess, std::memory_order_relaxed);
+			result = SendResult::QueuedDroppingOldest;
+		}
+		// Whatever the receiver discards makes room in the dispatcher as well
+		if (excess > receiverExcess)
+		{
+			rDropCount = excess - receiverExcess;
+			result = SendResult::QueuedDroppingOldest;
+		}
+	}
+
+	if (m_softCapacity > 0 
+		&& newSize >= m_softCapacity 
+		&& !m_aboveHighWater.load())
+	{
+		UpdateWaterMark(m_aboveHighWater, m_totalSize, m_softCapacity, ALL_RECEIVERS);
+	}
+	if (pLoad 
+		&& m_receiverSoftCapacity > 0 
+		&& newReceiverSize >= m_receiverSoftCapacity 
+		&& !pLoad->aboveHighWater.load())
+	{
+		UpdateWaterMark(pLoad->aboveHighWater, pLoad->size, m_receiverSoftCapacity, rcvrId);
+	}
+
+	return result;
+}
+
+bool impl_ns::MessageDequeDispatcher::TryReserve(ReceiverLoad_* pLoad, 
+	size_t count, 
+	size_t slack,
+	size_t& rNewSize, 
+	size_t& rNewReceiverSize)
+{
+	if (pLoad 
+		&& !TryAddSize(pLoad->size, count, m_receiverHardCapacity * slack, rNewReceiverSize))
+	{
+		return false;
+	}
+
+	if (!TryAddSize(m_totalSize, count, m_hardCapacity * slack, rNewSize))
+	{
+		if (pLoad)
+		{
+			pLoad->size -= count;
+		}
+		return false;
+	}
+
+	return true;
+}
+
+void impl_ns::MessageDequeDispatcher::ReleaseCapacity(ReceiverID rcvrId, ReceiverLoad_* pLoad)
+{
+	size_t size = --m_totalSize;
+	if (!m_limited)
+	{
+		return;
+	}
+
+	if (m_softCapacity > 0 
+		&& size <= m_softCapacity / 2 
+		&& m_aboveHighWater.load())
+	{
+		UpdateWaterMark(m_aboveHighWater, m_totalSize, m_softCapacity, ALL_RECEIVERS);
+	}
+
+	if (pLoad && m_receiverLimited)
+	{
+		size_t receiverSize = --pLoad->size;
+		if (m_receiverSoftCapacity > 0 
+			&& receiverSize <= m_receiverSoftCapacity / 2 
+			&& pLoad->aboveHighWater.load())
+		{
+			UpdateWaterMark(pLoad->aboveHighWater, pLoad->size, m_receiverSoftCapacity, rcvrId);
+		}
+	}
+}
+
+void impl_ns::MessageDequeDispatcher::UpdateWaterMark(std::atomic<bool>& rAboveHighWater,
+	const std::atomic<size_t>& rSize,
+	size_t softCapacity,
+	ReceiverID rcvrId)
+{
+	std::unique_lock lkWaterMark(m_mutexWaterMark);
+
+	// Senders and the consumer only come here when the flag looks stale, and may race each
+	// other on the way.  The flag is always stored before the size is read again, so
+	// whichever of the two comes second sees the other's change
+	while (true)
+	{
+		size_t size = rSize.load();
+		if (!rAboveHighWater.load() && size >= softCapacity)
+		{
+			rAboveHighWater.store(true);
+			for (const std::shared_ptr<IFlowControlListener>& pListener : m_flowControlListeners)
+			{
+				pListener->OnHighWater(rcvrId);
+			}
+		}
+		else if (rAboveHighWater.load() && size <= softCapacity / 2)
+		{
+			rAboveHighWater.store(false);
+			for (const std::shared_ptr<IFlowControlListener>& pListener : m_flowControlListeners)
+			{
+				pListener->OnLowWater(rcvrId);
+			}
+		}
+		else
+		{
+			break;
+		}
+	}
+}
+
+void impl_ns::MessageDequeDispatcher::AddFlowControlListener(const std::shared_ptr<IFlowControlListener>& pListener)
+{
+	std::unique_lock lkWaterMark(m_mutexWaterMark);
+	m_flowControlListeners.push_back(pListener);
+}
+
+void impl_ns::MessageDequeDispatcher::RemoveFlowControlListener(const std::shared_ptr<IFlowControlListener>& pListener)
+{
+	std::unique_lock lkWaterMark(m_mutexWaterMark);
+	m_flowControlListeners.erase(std::remove(m_flowControlListeners.begin(), m_flowControlListeners.end(), pListener),
+		m_flowControlListeners.end());
+}
+
+impl_ns::MessageDequeDispatcher::ReceiverLoad_* 
+	impl_ns::MessageDequeDispatcher::GetReceiverLoad(ReceiverID rcvrId) const
+{
+	size_t chunkIdx = rcvrId / LOAD_CHUNK_SIZE;
+	if (!m_receiverLoads || chunkIdx >= MAX_LOAD_CHUNKS)
+	{
+		return nullptr;
+	}
+
+	ReceiverLoad_* pChunk = m_receiverLoads[chunkIdx].load(std::memory_order_acquire);
+	return pChunk ? pChunk + rcvrId % LOAD_CHUNK_SIZE : nullptr;
+}
+
+void impl_ns::MessageDequeDispatcher::AddReceiverLoad(ReceiverID rcvrId)
 {
-	MQDMessageEnvelope envelope(rcvrId, std::move(pMessage));
-	++m_totalSize;
-	PostMessage(std::move(envelope), m_queue);
+	size_t chunkIdx = rcvrId / LOAD_CHUNK_SIZE;
+	if (!m_receiverLoads || chunkIdx >= MAX_LOAD_CHUNKS)
+	{
+		return;
+	}
+
+	std::unique_lock lkQueue(m_mutexQueue);
+	ReceiverLoad_* pChunk = m_receiverLoads[chunkIdx].load(std::memory_order_relaxed);
+	if (!pChunk)
+	{
+		m_receiverLoadChunks.emplace_back(std::make_unique<ReceiverLoad_[]>(LOAD_CHUNK_SIZE));
+		pChunk = m_receiverLoadChunks.back().get();
+		m_receiverLoads[chunkIdx].store(pChunk, std::memory_order_release);
+	}
+	pChunk[rcvrId % LOAD_CHUNK_SIZE].active.store(true, std::memory_order_relaxed);
+}
+
+uint32_t impl_ns::MessageDequeDispatcher::GetEnqueueStamp() const
+{
+	// Per thread rather than per dispatcher, so that senders do not share a counter
+	thread_local uint32_t sendCount{ 0 };
+
+	if (!m_sampleTimeInQueue 
+		|| (++sendCount & m_sampleMask) != 0)
+	{
+		return 0;
+	}
+
+	// Zero means "not sampled"
+	uint32_t stamp = GetMicrosecondStamp();
+	return stamp != 0 ? stamp : 1;
+}
+
+void impl_ns::MessageDequeDispatcher::RecordTimeInQueue(uint32_t enqueueStamp)
+{
+	// Unsigned arithmetic takes care of the wraparound
+	uint32_t waited = GetMicrosecondStamp() - enqueueStamp;
+
+	size_t bucket{ 0 };
+	while (bucket < DispatcherMetrics::TIME_IN_QUEUE_BUCKETS - 1 
+		&& waited >= (1u << bucket))
+	{
+		++bucket;
+	}
+	BumpCounter(m_timeInQueue[bucket]);
+}
+
+void impl_ns::MessageDequeDispatcher::GetMetrics(DispatcherMetrics& rMetrics) const
+{
+	rMetrics.messagesDequeued = m_msgsDequeued.load(std::memory_order_relaxed);
+	rMetrics.messagesLost = m_msgsLost.load(std::memory_order_relaxed);
+	rMetrics.messagesDropped = m_msgsDropped.load(std::memory_order_relaxed);
+	rMetrics.messagesDroppedNewest = m_msgsDroppedNewest.load(std::memory_order_relaxed);
+	rMetrics.messagesRejected = m_msgsRejected.load(std::memory_order_relaxed);
+	rMetrics.queueDepth = m_totalSize.load(std::memory_order_relaxed);
+
+	for (size_t bucket = 0; bucket < DispatcherMetrics::TIME_IN_QUEUE_BUCKETS; ++bucket)
+	{
+		rMetrics.timeInQueue[bucket] = m_timeInQueue[bucket].load(std::memory_order_relaxed);
+	}
+
+	rMetrics.receivers.clear();
+	ReceiverID rcvrEnd = m_freeRcvId.load();
+	for (ReceiverID rcvrId = 0; rcvrId < rcvrEnd; ++rcvrId)
+	{
+		const ReceiverLoad_* pLoad = GetReceiverLoad(rcvrId);
+		if (!pLoad || !pLoad->active.load(std::memory_order_relaxed))
+		{
+			continue;
+		}
+
+		ReceiverMetrics receiverMetrics;
+		receiverMetrics.id = rcvrId;
+		receiverMetrics.messagesDequeued = pLoad->messagesDequeued.load(std::memory_order_relaxed);
+		receiverMetrics.messagesDropped = pLoad->messagesDropped.load(std::memory_order_relaxed);
+		receiverMetrics.queueDepth = m_receiverLimited ? pLoad->size.load(std::memory_order_relaxed) : 0;
+		rMetrics.receivers.push_back(receiverMetrics);
+	}
+}
+
+void impl_ns::MessageDequeDispatcher::SetConsumerPinned(bool consumerPinned)
+{
+	m_consumerPinned.store(consumerPinned, std::memory_order_relaxed);
+}
+
+bool impl_ns::MessageDequeDispatcher::IsConsumerThread() const
+{
+	// A consumer pinned to this thread cannot run while a sender here waits, even between
+	// calls.  One that moves between threads can, unless this thread is running it now
+	if (m_consumerPinned.load(std::memory_order_relaxed))
+	{
+		return std::this_thread::get_id() == m_consumerThread.load(std::memory_order_relaxed);
+	}
+
+	return tl_pProcessingDispatcher == this;
+}
+
+bool impl_ns::MessageDequeDispatcher::IsSendingFromHandler() const
+{
+	return m_sameThreadDelivery && tl_pProcessingDispatcher == this;
+}
+
+bool impl_ns::MessageDequeDispatcher::UseSameThreadPath(size_t count, bool spillPending)
+{
+	// Only the thread running ProcessMessages can see itself here, so nothing below races.
+	// Appending to the local queues keeps each sender's order as long as nothing this thread
+	// sent earlier is still waiting in the shared queues.  That holds until a handler's send
+	// takes the normal path (once the budget is spent), and stops holding for that lane until
+	// TakeIncoming has moved the shared queue onto the local one, which may be some calls
+	// later if the local queue was not used up.  Nor may a message overtake a receiver's 
+	// create envelope: one sent right after CreateReceiver would find no receiver
+	if (!IsSendingFromHandler()
+		|| spillPending
+		|| m_controlPending.load(std::memory_order_acquire))
+	{
+		return false;
+	}
+
+	if (m_sameThreadSent + count > m_sameThreadBudget)
+	{
+		m_sameThreadSent = m_sameThreadBudget;
+		return false;
+	}
+
+	m_sameThreadSent += count;
+	m_sameThreadAppended = true;
+	return true;
+}
+
+void impl_ns::MessageDequeDispatcher::SendSignal()
+{
+	m_signalsSent.fetch_add(1, std::memory_order_relaxed);
+	DoSignal();
+}
+
+void impl_ns::MessageDequeDispatcher::SignalIfArmed()
+{
+	// The size was bumped before this exchange.  Both are sequentially consistent, so
+	// either this sender sees the armed flag or the consumer in RearmSignal() sees the message
+	if (m_signalArmed.exchange(false))
+	{
+		SendSignal();
+	}
+	else
+	{
+		m_signalsSuppressed.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+bool impl_ns::MessageDequeDispatcher::RearmSignal()
+{
+	m_signalArmed.store(true);
+
+	if (m_totalSize.load() > 0)
+	{
+		// Something arrived after the queues were drained.  If a sender has already taken
+		// the flag, its signal is on the way and it is safe to suspend
+		return m_signalArmed.exchange(false);
+	}
+
+	return false;
+}
+
+void impl_ns::MessageDequeDispatcher::ReserveOnConsumerThread(size_t messagesPerLane)
+{
+	for (size_t laneIdx = 0; laneIdx < m_laneCount; ++laneIdx)
+	{
+		Lane_& lane = m_lanes[laneIdx];
+
+		// Both halves of the double buffer, since they trade places
+		lane.localQueue.reserve(messagesPerLane);
+		{
+			std::unique_lock lkQueue(m_mutexQueue);
+			lane.queue.reserve(messagesPerLane);
+		}
+
+		if (m_receiverQuantum > 0)
+		{
+			lane.deferred.reserve(messagesPerLane);
+			lane.carry.reserve(messagesPerLane);
+		}
+	}
+}
+
+msg_ns::MQDSignalStats impl_ns::MessageDequeDispatcher::GetSignalStats() const
+{
+	MQDSignalStats stats;
+	stats.signalsSent = m_signalsSent.load(std::memory_order_relaxed);
+	stats.signalsSuppressed = m_signalsSuppressed.load(std::memory_order_relaxed);
+	return stats;
 }
 
 msg_ns::ReceiverID
@@ -40,6 +695,8 @@ impl_ns::MessageDequeDispatcher::CreateReceiver(const std::shared_ptr<msg_ns::IM
 	}
 
 	ReceiverID newReceiverID = m_freeRcvId++;
+	// Before the ID is handed out, so that every message sent to it is counted
+	AddReceiverLoad(newReceiverID);
 	MQDCreateReceiverEnvelope envelope(newReceiverID, pListener, pFilter, dispatchId);
 	PostMessage(std::move(envelope), m_createQueue);
 	return newReceiverID;
@@ -76,16 +733,21 @@ std::shared_ptr<impl_ns::ISenderEndpoint> impl_ns::MessageDequeDispatcher::Creat
 */
 
 
-void impl_ns::MessageDequeDispatcher::MQDMessageEnvelope::Act(MessageDequeDispatcher& dispatcher)
+void impl_ns::MessageDequeDispatcher::MQDMessageEnvelope::Act(MessageDequeDispatcher& dispatcher,
+	Receiver_* pReceiver)
 {
-	auto itReceiver = dispatcher.m_receiverMap.find(GetReceiverID());
-	if (itReceiver != dispatcher.m_receiverMap.end())
+	// Processed envelopes stay in the local buffer until it is recycled, so take the message
+	// out to release it as soon as it has been handled.  Do not touch the envelope after
+	// dispatching: a same-thread send may reallocate the buffer it lives in
+	std::shared_ptr<IMessage> pMessage(std::move(m_pMessage));
+
+	if (pReceiver)
 	{
-		itReceiver->second.Dispatch(m_pMessage);
+		pReceiver->Dispatch(pMessage);
 	}
 	else
 	{
-		dispatcher.OnLostMessage(m_pMessage, GetReceiverID());
+		dispatcher.OnLostMessage(pMessage, GetReceiverID());
 	}
 }
 
@@ -100,6 +762,12 @@ void impl_ns::MessageDequeDispatcher::MQDCreateReceiverEnvelope::Act(MessageDequ
 
 void impl_ns::MessageDequeDispatcher::MQDRemoveReceiverEnvelope::Act(MessageDequeDispatcher& dispatcher)
 {
+	ReceiverLoad_* pLoad = dispatcher.GetReceiverLoad(GetReceiverID());
+	if (pLoad)
+	{
+		pLoad->active.store(false, std::memory_order_relaxed);
+	}
+
 	auto itReceiver = dispatcher.m_receiverMap.find(GetReceiverID());
 	if (itReceiver != dispatcher.m_receiverMap.end())
 	{
@@ -107,52 +775,305 @@ void impl_ns::MessageDequeDispatcher::MQDRemoveReceiverEnvelope::Act(MessageDequ
 	}
 }
 
-void impl_ns::MessageDequeDispatcher::ProcessMessages(WorkStateDescription& workState)
+void impl_ns::MessageDequeDispatcher::Lane_::RecycleLocalQueue()
 {
+	if (localHead == localQueue.size())
 	{
-		std::unique_lock lkQueue(m_mutexQueue);
-		if (m_localQueue.empty())
+		localQueue.clear();
+		localHead = 0;
+	}
+}
+
+void impl_ns::MessageDequeDispatcher::Lane_::CarryDeferred()
+{
+	deferLimitHit = false;
+	if (deferred.empty())
+	{
+		return;
+	}
+
+	if (carryHead == carry.size())
+	{
+		carry.clear();
+		carryHead = 0;
+		carry.swap(deferred);
+		return;
+	}
+
+	// The carry buffer was not used up, so the local queue was never reached: every deferred
+	// message came out of the carry buffer, from in front of carryHead.  Put them back there
+	carryHead -= deferred.size();
+	std::move(deferred.begin(), deferred.end(), carry.begin() + carryHead);
+	deferred.clear();
+}
+
+void impl_ns::MessageDequeDispatcher::Lane_::DrainRing()
+{
+	RecycleLocalQueue();
+	while (pRing->TryConsume([this](MQDMessageEnvelope&& envelope)
 		{
-			m_localQueue.swap(m_queue);
+			localQueue.emplace_back(std::move(envelope));
+		}));
+}
+
+void impl_ns::MessageDequeDispatcher::TakeIncoming()
+{
+	// Anything urgent sent from here on is picked up by the next call
+	m_priorityPending.store(false, std::memory_order_relaxed);
+
+	// Drain the rings before taking the control queues.  A message in a ring for a new 
+	// receiver was sent after CreateReceiver returned, so its create envelope is already
+	// waiting in m_createQueue
+	for (size_t laneIdx = 0; laneIdx < m_laneCount; ++laneIdx)
+	{
+		if (m_lanes[laneIdx].pRing)
+		{
+			m_lanes[laneIdx].DrainRing();
 		}
+	}
 
-		m_localCreateQueue.swap(m_createQueue);
-		m_localRemoveQueue.swap(m_removeQueue);
+	std::unique_lock lkQueue(m_mutexQueue);
+	for (size_t laneIdx = 0; laneIdx < m_laneCount; ++laneIdx)
+	{
+		Lane_& lane = m_lanes[laneIdx];
+		if (lane.pRing)
+		{
+			if (lane.ringOverflow.load(std::memory_order_relaxed))
+			{
+				// Everything that spilled is newer than what was in the ring just now.  Stop
+				// the diversion only once the overflow is in hand
+				lane.DrainRing();
+				for (MQDMessageEnvelope& rEnvelope : lane.queue)
+				{
+					lane.localQueue.emplace_back(std::move(rEnvelope));
+				}
+				lane.queue.clear();
+				lane.ringOverflow.store(false, std::memory_order_release);
+			}
+			// The ring was drained above, and any overflow just now
+			lane.sameThreadSpill = false;
+		}
+		else
+		{
+			// Only trade buffers once the local one is used up; otherwise its remainder
+			// would be overtaken by newer messages
+			lane.RecycleLocalQueue();
+			if (lane.localQueue.empty())
+			{
+				lane.localQueue.swap(lane.queue);
+				lane.sameThreadSpill = false;
+			}
+		}
 	}
 
+	m_localCreateQueue.swap(m_createQueue);
+	m_localRemoveQueue.swap(m_removeQueue);
+	m_controlPending.store(false, std::memory_order_relaxed);
+}
+
+void impl_ns::MessageDequeDispatcher::ProcessControl()
+{
 	// Process all create and then all remove requests
-	while (!m_localCreateQueue.empty())
+	for (MQDCreateReceiverEnvelope& rEnvelope : m_localCreateQueue)
 	{
-		m_localCreateQueue.back().Act(*this);
-		m_localCreateQueue.pop_back();
+		rEnvelope.Act(*this);
 	}
+	m_localCreateQueue.clear();
 
-	while (!m_localRemoveQueue.empty())
+	for (MQDRemoveReceiverEnvelope& rEnvelope : m_localRemoveQueue)
 	{
-		m_localRemoveQueue.back().Act(*this);
-		m_localRemoveQueue.pop_back();
+		rEnvelope.Act(*this);
 	}
+	m_localRemoveQueue.clear();
+}
+
+impl_ns::MessageDequeDispatcher::Receiver_* 
+	impl_ns::MessageDequeDispatcher::FindReceiver(ReceiverID rcvrId)
+{
+	auto itReceiver = m_receiverMap.find(rcvrId);
+	return itReceiver != m_receiverMap.end() ? &itReceiver->second : nullptr;
+}
+
+bool impl_ns::MessageDequeDispatcher::ChargeReceiver(Receiver_& receiver)
+{
+	if (receiver.quantumEpoch != m_processEpoch)
+	{
+		receiver.quantumEpoch = m_processEpoch;
+		receiver.quantumUsed = 0;
+	}
+
+	if (receiver.quantumUsed >= m_receiverQuantum)
+	{
+		return false;
+	}
+
+	++receiver.quantumUsed;
+	return true;
+}
+
+size_t impl_ns::MessageDequeDispatcher::DrainLanes(const WorkStateDescription& workState)
+{
+	// Reading the clock for every message would cost more than most messages do
+	constexpr size_t DEADLINE_CHECK_INTERVAL = 32;
+	// How far past receivers that have used up their quantum we look for other work
+	constexpr size_t MAX_DEFERRED = 256;
 
-	size_t msgsProcessed = 0;
 	size_t msgsToProcess = workState.msgsToProcess > 0 ? workState.msgsToProcess : std::numeric_limits<size_t>::max();
+	bool hasDeadline = workState.deadline != std::chrono::steady_clock::time_point{};
 
-	while (msgsProcessed < msgsToProcess 
-		&& !m_localQueue.empty())
+	size_t msgsProcessed = 0;
+	size_t msgsSinceClock = 0;
+	bool haveLocal{ true };
+
+	while (msgsProcessed < msgsToProcess && haveLocal)
 	{
-		MQDMessageEnvelope& rEnvelope = m_localQueue.back();
-		rEnvelope.Act(*this);
-		
-		m_localQueue.pop_back();
-		++msgsProcessed;
-		--m_totalSize;
+		// One weighted cycle, most urgent lane first
+		haveLocal = false;
+		m_sameThreadAppended = false;
+		for (size_t laneIdx = m_laneCount; laneIdx > 0; --laneIdx)
+		{
+			Lane_& lane = m_lanes[laneIdx - 1];
+			if (lane.deferLimitHit)
+			{
+				continue;
+			}
+			size_t laneBudget = std::min(lane.weight, msgsToProcess - msgsProcessed);
+
+			size_t laneProcessed = 0;
+			while (laneProcessed < laneBudget && lane.HasLocal())
+			{
+				MQDMessageEnvelope& rEnvelope = lane.NextLocal();
+				ReceiverID rcvrId = rEnvelope.GetReceiverID();
+				ReceiverLoad_* pLoad = GetReceiverLoad(rcvrId);
+
+				// Owed to DropOldest.  These are the oldest messages of the lane (or receiver)
+				// still waiting
+				if (TakeDropDebt(lane.dropDebt)
+					|| (pLoad && TakeDropDebt(pLoad->dropDebt)))
+				{
+					BumpCounter(m_msgsDropped);
+					if (pLoad)
+					{
+						BumpCounter(pLoad->messagesDropped);
+					}
+					OnDroppedMessage(rEnvelope.TakeMessage(), rcvrId);
+					ReleaseCapacity(rcvrId, pLoad);
+					continue;
+				}
+
+				Receiver_* pReceiver = FindReceiver(rcvrId);
+
+				if (m_receiverQuantum > 0 
+					&& pReceiver 
+					&& !ChargeReceiver(*pReceiver))
+				{
+					lane.deferred.emplace_back(std::move(rEnvelope));
+					if (lane.deferred.size() >= MAX_DEFERRED)
+					{
+						// Leave the rest of the lane where it is until the next call
+						lane.deferLimitHit = true;
+						break;
+					}
+					continue;
+				}
+
+				if (rEnvelope.GetEnqueueStamp() != 0)
+				{
+					RecordTimeInQueue(rEnvelope.GetEnqueueStamp());
+				}
+				if (!pReceiver)
+				{
+					BumpCounter(m_msgsLost);
+				}
+				else if (pLoad)
+				{
+					BumpCounter(pLoad->messagesDequeued);
+				}
+
+				rEnvelope.Act(*this, pReceiver);
+				++laneProcessed;
+				ReleaseCapacity(rcvrId, pLoad);
+
+				if (hasDeadline && ++msgsSinceClock == DEADLINE_CHECK_INTERVAL)
+				{
+					msgsSinceClock = 0;
+					if (std::chrono::steady_clock::now() >= workState.deadline)
+					{
+						return msgsProcessed + laneProcessed;
+					}
+				}
+			}
+			msgsProcessed += laneProcessed;
+			haveLocal = haveLocal || (!lane.deferLimitHit && lane.HasLocal());
+		}
+		// A handler may have sent to a lane this cycle has already been through
+		haveLocal = haveLocal || m_sameThreadAppended;
+
+		// Urgent messages that arrived meanwhile should not wait for the rest of the bulk.
+		// Control envelopes come along so that a new receiver is known before its first 
+		// message.  Only done while there is local work left, so one call still ends
+		if (haveLocal 
+			&& m_priorityPending.load(std::memory_order_acquire))
+		{
+			TakeIncoming();
+			ProcessControl();
+		}
+	}
+
+	return msgsProcessed;
+}
+
+void impl_ns::MessageDequeDispatcher::ProcessMessages(WorkStateDescription& workState)
+{
+	m_consumerThread.store(std::this_thread::get_id(), std::memory_order_relaxed);
+
+	const MessageDequeDispatcher* pPrevious{ nullptr };
+	lib::RaiiLambda processingScope([this, &pPrevious]()
+		{
+			pPrevious = tl_pProcessingDispatcher;
+			tl_pProcessingDispatcher = this;
+			m_sameThreadSent = 0;
+		},
+		[&pPrevious]()
+		{
+			tl_pProcessingDispatcher = pPrevious;
+		});
+
+	++m_processEpoch;
+	for (size_t laneIdx = 0; laneIdx < m_laneCount; ++laneIdx)
+	{
+		m_lanes[laneIdx].CarryDeferred();
 	}
 
+	TakeIncoming();
+	ProcessControl();
+
+	BumpCounter(m_msgsDequeued, DrainLanes(workState));
+
 	workState.msgsRemaining = m_totalSize.load();
+
+	// The sizes went down before this load, and blocked senders count themselves in before
+	// they check the sizes, so none of them can miss this
+	if (m_blockedSenders.load() > 0)
+	{
+		std::unique_lock lkSpace(m_mutexSpace);
+		m_cvSpace.notify_all();
+	}
 }
 
 
-void impl_ns::MessageDequeDispatcher::OnLostMessage(const std::shared_ptr<IMessage>& pMessage,
+void impl_ns::MessageDequeDispatcher::OnLostMessage(const std::shared_ptr<IMessage>&,
 	ReceiverID rcvId)
 {
+	if (m_traceLostMessages)
+	{
+		std::cerr << "MessageDequeDispatcher (" << GetExecutionThreadName() 
+			<< "): lost a message for unknown receiver " << rcvId << '\n';
+	}
+}
+
+void impl_ns::MessageDequeDispatcher::OnDroppedMessage(const std::shared_ptr<IMessage>&,
+	ReceiverID)
+{
 
 }
\ No newline at end of file
@@ -1,17 +1,90 @@
 #pragma once
 
 #include "Messaging.h"
+#include "MPSCRing.h"
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <shared_mutex>
-#include <deque>
+#include <vector>
 #include <unordered_map>
 #include <unordered_set>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <thread>
 
 namespace holder::messages
 {
+	enum class MQDQueueType
+	{
+		// Data messages go into a mutex-protected queue
+		Deque,
+		// Data messages go into a bounded lock-free ring; senders only fall back to the
+		// mutex when the ring is full
+		LockFreeRing
+	};
+
+	// What a sender gets when a hard capacity is reached
+	enum class MQDOverflowPolicy
+	{
+		// Wait for room.  A sender on the dispatcher's own thread is rejected instead
+		Block,
+		// Queue the message and discard as many of the oldest ones, when the consumer gets to
+		// them.  The queue may run up to twice its capacity meanwhile; past that, new
+		// messages are dropped
+		DropOldest,
+		DropNewest,
+		Reject
+	};
 
-	// A deque-based message dispatcher, with customizable signal and block calls
+	// Wakeups that reached the executor versus those skipped because it was already awake
+	struct MQDSignalStats
+	{
+		uint64_t signalsSent{ 0 };
+		uint64_t signalsSuppressed{ 0 };
+	};
+
+	struct MQDOptions
+	{
+		bool traceLostMessages{ false };
+		MQDQueueType queueType{ MQDQueueType::Deque };
+		// Only used by LockFreeRing.  Rounded up to a power of two, per lane
+		size_t ringCapacity{ 4096 };
+		// Number of priority lanes.  A message goes to lane min(priority, laneCount - 1)
+		size_t laneCount{ 1 };
+		// Messages taken from each lane per drain cycle, starting at lane 0.  Lanes without
+		// an entry get four times the weight of the lane below (lane 0 gets 1)
+		std::vector<uint32_t> laneWeights;
+		// How much an executor may process in one Run() before yielding its thread to the
+		// other executors there.  Zero means no limit
+		size_t quantumMessages{ 0 };
+		std::chrono::microseconds quantumTime{ 0 };
+		// Messages one receiver may take per ProcessMessages call; the rest of its messages
+		// wait for the next call so that a busy receiver cannot starve its neighbours.
+		// Zero means no limit
+		size_t receiverQuantum{ 0 };
+		// Backpressure, for the dispatcher as a whole and for each receiver.  Reaching a soft
+		// capacity calls OnHighWater on the flow control listeners, and falling to half of it
+		// calls OnLowWater.  Hard capacities are enforced with overflowPolicy.
+		// Zero means no limit
+		size_t softCapacity{ 0 };
+		size_t hardCapacity{ 0 };
+		size_t receiverSoftCapacity{ 0 };
+		size_t receiverHardCapacity{ 0 };
+		MQDOverflowPolicy overflowPolicy{ MQDOverflowPolicy::Reject };
+		// One message in this many (per sending thread) is timestamped for the time-in-queue
+		// histogram.  Rounded up to a power of two; zero turns sampling off
+		size_t timeInQueueSampling{ 64 };
+		// Messages sent from a handler running in this dispatcher go straight onto the local
+		// queues, to be processed in the same ProcessMessages call, instead of through the
+		// mutex and a signal.  Up to sameThreadBudget messages per call take this path, so a
+		// ping-pong between two receivers cannot hold the thread forever
+		bool sameThreadDelivery{ false };
+		size_t sameThreadBudget{ 1024 };
+	};
+
+	// A queue-based message dispatcher, with customizable signal and block calls
 	// Since blocking/signal behavior may be different in thread vs task-based environments,
 	// this abstraction makes sense
 	class MessageDequeDispatcher : public IMessageDispatcher
@@ -22,9 +95,13 @@ namespace holder::messages
 		{
 			size_t msgsToProcess;
 			size_t msgsRemaining;
+			// Stop processing once this is past.  The default (epoch) means no deadline
+			std::chrono::steady_clock::time_point deadline{};
 		};
 
 	private:
+		struct Receiver_;
+
 		enum class SpecialMessageType
 		{
 			None,
@@ -57,13 +134,23 @@ namespace holder::messages
 			MQDMessageEnvelope& operator=(MQDMessageEnvelope&&) = default;
 
 			MQDMessageEnvelope(ReceiverID receiverId,
-				std::shared_ptr<IMessage> pMessage)
+				std::shared_ptr<IMessage> pMessage,
+				uint32_t enqueueStamp)
 				:MQDEnvelope(receiverId),
+				m_enqueueStamp(enqueueStamp),
 				m_pMessage(std::move(pMessage))
 			{ }
 
-			void Act(MessageDequeDispatcher& dispatcher);
+			// Zero unless this message was sampled for the time-in-queue histogram
+			uint32_t GetEnqueueStamp() const { return m_enqueueStamp; }
+
+			// pReceiver is null if the receiver is unknown
+			void Act(MessageDequeDispatcher& dispatcher, Receiver_* pReceiver);
+			// For messages discarded unprocessed
+			std::shared_ptr<IMessage> TakeMessage() { return std::move(m_pMessage); }
 		private:
+			// Microseconds, wrapping.  Fits next to the receiver ID, so it costs no space
+			uint32_t m_enqueueStamp;
 			std::shared_ptr<IMessage> m_pMessage;
 		};
 
@@ -130,19 +217,45 @@ namespace holder::messages
 				std::shared_ptr<IMessageFilter> pFilter,
 				DispatchID dispatchId) override;
 		void RemoveReceiver(ReceiverID rcvrId) override;
-		void SendMessage(ReceiverID rcvrId, std::shared_ptr<IMessage> pMessage) override;
+		SendResult SendMessage(ReceiverID rcvrId, std::shared_ptr<IMessage> pMessage) override;
+		SendResult SendMessage(ReceiverID rcvrId, std::shared_ptr<IMessage> pMessage,
+			MessagePriority priority) override;
+		// One lock acquisition (at most, in ring mode) and one signal for the whole batch
+		SendResult SendMessages(ReceiverID rcvrId, MessageSpan messages) override;
+		SendResult SendMessages(ReceiverID rcvrId, MessageSpan messages,
+			MessagePriority priority) override;
+		void AddFlowControlListener(const std::shared_ptr<IFlowControlListener>& pListener) override;
+		void RemoveFlowControlListener(const std::shared_ptr<IFlowControlListener>& pListener) override;
+
+		// Any thread
+		MQDSignalStats GetSignalStats() const;
+		void GetMetrics(DispatcherMetrics& rMetrics) const override;
 
 	protected:
-		// TODO: Flags if the options multiply
-		MessageDequeDispatcher(bool traceLostMessages)
-			:m_traceLostMessages(traceLostMessages)
-		{ }
+		MessageDequeDispatcher(const MQDOptions& options);
 
 		void ProcessMessages(WorkStateDescription& workState);
 		virtual void DoSignal() = 0;
 
+		// Data messages only signal on the transition from "idle" to "has work".  The consumer
+		// calls this when it has nothing left and is about to suspend; if it returns true, 
+		// messages raced in without a signal and the consumer must keep running
+		bool RearmSignal();
+
+		// Gives every lane room for this many messages, allocated by the calling thread.  Called
+		// on the consumer thread before processing, this keeps the buffers local to its node
+		void ReserveOnConsumerThread(size_t messagesPerLane);
+
+		// Whether ProcessMessages always runs on the same thread (the default).  Cleared for a
+		// consumer that moves between threads, e.g. in the executor pool, so that a sender is
+		// only taken for the consumer while it is actually running it
+		void SetConsumerPinned(bool consumerPinned);
+
 		virtual void OnLostMessage(const std::shared_ptr<IMessage>& pMessage,
 			ReceiverID rcvId);
+		// A message discarded by MQDOverflowPolicy::DropOldest.  Consumer thread
+		virtual void OnDroppedMessage(const std::shared_ptr<IMessage>& pMessage,
+			ReceiverID rcvId);
 
 	private:
 		struct Receiver_
@@ -152,6 +265,10 @@ namespace holder::messages
 			std::shared_ptr<IMessageListener> pListener;
 			std::shared_ptr<IMessageFilter> pFilter;
 
+			// Receiver quantum accounting; reset lazily when the epoch moves on
+			uint64_t quantumEpoch{ 0 };
+			size_t quantumUsed{ 0 };
+
 			Receiver_(ReceiverID id_, 
 				DispatchID dispatchId_,
 				std::shared_ptr<IMessageListener> pListener_,
@@ -168,33 +285,209 @@ namespace holder::messages
 			}
 		};
 
+		// Control envelopes are rare and are not counted in m_totalSize, so they always signal
 		template<typename MsgEnvelope>
-		void PostMessage(MsgEnvelope&& env, std::deque<MsgEnvelope>& queue)
+		void PostMessage(MsgEnvelope&& envelope, std::vector<MsgEnvelope>& queue)
 		{
-			std::unique_lock lkQueue(m_mutexQueue);
-			queue.push_front(std::move(envelope));
-			DoSignal();
+			{
+				std::unique_lock lkQueue(m_mutexQueue);
+				queue.emplace_back(std::move(envelope));
+				m_controlPending.store(true, std::memory_order_release);
+			}
+			SendSignal();
+		}
+
+		// Data messages of one priority.  Each lane is double-buffered: senders append to
+		// "queue" under m_mutexQueue, the consumer works through "localQueue".  Once the local
+		// queue has been consumed it is cleared (keeping its capacity) and traded for the shared
+		// one, so in steady state neither side allocates
+		struct Lane_
+		{
+			std::vector<MQDMessageEnvelope> queue;
+			std::vector<MQDMessageEnvelope> localQueue;
+			// Next envelope to process in localQueue
+			size_t localHead{ 0 };
+			size_t weight{ 0 };
+
+			// Receiver quantum: messages held back in this call go to "deferred", and are
+			// processed ahead of everything else in the next call from "carry"
+			std::vector<MQDMessageEnvelope> deferred;
+			std::vector<MQDMessageEnvelope> carry;
+			size_t carryHead{ 0 };
+			// Set when too many messages were deferred in this call to keep looking
+			bool deferLimitHit{ false };
+
+			// Only present with MQDQueueType::LockFreeRing.  Once the ring has filled up, senders
+			// divert to "queue" (under the mutex) until the consumer has taken the overflow;
+			// otherwise a sender could see its later message overtake an earlier spilled one
+			std::unique_ptr<lib::MPSCRing<MQDMessageEnvelope> > pRing;
+			std::atomic<bool> ringOverflow{ false };
+
+			// How many of this lane's oldest messages are to be discarded (DropOldest)
+			std::atomic<size_t> dropDebt{ 0 };
+
+			// Consumer thread only.  Set when a handler's send went the normal way, into the
+			// ring or "queue"; until TakeIncoming has moved that onto the local queue, later 
+			// sends from handlers must not go straight to the local queue ahead of it
+			bool sameThreadSpill{ false };
+
+			bool HasLocal() const { return carryHead < carry.size() || localHead < localQueue.size(); }
+			// Oldest first: the carried-over messages, then the local queue
+			MQDMessageEnvelope& NextLocal()
+			{
+				return carryHead < carry.size() ? carry[carryHead++] : localQueue[localHead++];
+			}
+			void RecycleLocalQueue();
+			// Called once per ProcessMessages, before anything is processed
+			void CarryDeferred();
+			// Appends everything published so far in the ring to the local queue
+			void DrainRing();
+		};
+
+		// Per-receiver state that other threads read: capacity accounting for the senders,
+		// metrics for anyone.  Receiver IDs are handed out densely, so this lives in 
+		// fixed-size chunks indexed by ID rather than in a map
+		struct ReceiverLoad_
+		{
+			std::atomic<size_t> size{ 0 };
+			std::atomic<size_t> dropDebt{ 0 };
+			std::atomic<bool> aboveHighWater{ false };
+
+			// Written by the consumer only
+			std::atomic<bool> active{ false };
+			std::atomic<uint64_t> messagesDequeued{ 0 };
+			std::atomic<uint64_t> messagesDropped{ 0 };
+		};
+
+		static constexpr size_t LOAD_CHUNK_SIZE = 256;
+		// Receivers past this many get no per-receiver limits
+		static constexpr size_t MAX_LOAD_CHUNKS = 4096;
+
+		size_t GetLaneIndex(MessagePriority priority) const
+		{
+			return priority < m_laneCount ? priority : m_laneCount - 1;
 		}
 
+		// The caller must hold lkQueue, or have it deferred, when the lane has no ring
+		void EnqueueMessage(size_t laneIdx, MQDMessageEnvelope&& envelope, 
+			std::unique_lock<std::mutex>& lkQueue);
+		void SendSignal();
+		void SignalIfArmed();
+		// Each message at its own priority unless one is given
+		SendResult SendBatch(ReceiverID rcvrId, MessageSpan messages,
+			std::optional<MessagePriority> priority);
+
+		// True if these messages can go straight onto the local queues.
+		// spillPending: one of the lanes the messages go to has sameThreadSpill set
+		bool UseSameThreadPath(size_t count, bool spillPending);
+		bool IsSendingFromHandler() const;
+		// Whether a sender on this thread blocking for space would hold up the consumer
+		bool IsConsumerThread() const;
+
+		// Null for IDs that were never handed out, or past the limit
+		ReceiverLoad_* GetReceiverLoad(ReceiverID rcvrId) const;
+		void AddReceiverLoad(ReceiverID rcvrId);
+		// Counts the messages in and applies the overflow policy.  rDropCount is set to how
+		// many of the dispatcher's oldest messages must go to make room
+		SendResult ReserveCapacity(ReceiverID rcvrId, size_t count, size_t& rDropCount);
+		bool TryReserve(ReceiverLoad_* pLoad, size_t count, size_t slack,
+			size_t& rNewSize, size_t& rNewReceiverSize);
+		// Counts one message out, when it has been processed or discarded
+		void ReleaseCapacity(ReceiverID rcvrId, ReceiverLoad_* pLoad);
+		// Fires whatever high/low water notifications the current size calls for
+		void UpdateWaterMark(std::atomic<bool>& rAboveHighWater, const std::atomic<size_t>& rSize,
+			size_t softCapacity, ReceiverID rcvrId);
+
+		// Sender side: zero, or the current time for a sampled message
+		uint32_t GetEnqueueStamp() const;
+		void RecordTimeInQueue(uint32_t enqueueStamp);
+
+		// Consumer side
+		void TakeIncoming();
+		void ProcessControl();
+		size_t DrainLanes(const WorkStateDescription& workState);
+		Receiver_* FindReceiver(ReceiverID rcvrId);
+		// Counts one message against the receiver's quantum; false if it is used up
+		bool ChargeReceiver(Receiver_& receiver);
+
 		std::mutex m_mutexQueue;
 		// The best way is to keep three different queues for three different types of messages
-		std::deque<MQDMessageEnvelope> m_queue;
-		std::deque<MQDCreateReceiverEnvelope> m_createQueue;
-		std::deque<MQDRemoveReceiverEnvelope> m_removeQueue;
-
-		std::atomic<size_t> m_totalSize;
+		// All of them are FIFO: senders append, the consumer reads front to back
+		std::unique_ptr<Lane_[]> m_lanes;
+		size_t m_laneCount{ 1 };
+		std::vector<MQDCreateReceiverEnvelope> m_createQueue;
+		std::vector<MQDRemoveReceiverEnvelope> m_removeQueue;
+		// Set while either of the above has something the consumer has not taken yet
+		std::atomic<bool> m_controlPending{ false };
+
+		// Set when something lands above lane 0, so the consumer can pick it up in the middle
+		// of a long drain instead of after it
+		std::atomic<bool> m_priorityPending{ false };
+
+		std::atomic<size_t> m_totalSize{ 0 };
+
+		size_t m_softCapacity{ 0 };
+		size_t m_hardCapacity{ 0 };
+		size_t m_receiverSoftCapacity{ 0 };
+		size_t m_receiverHardCapacity{ 0 };
+		MQDOverflowPolicy m_overflowPolicy{ MQDOverflowPolicy::Reject };
+		// False when there are no limits of any kind, so sends skip the accounting
+		bool m_limited{ false };
+		bool m_receiverLimited{ false };
+		std::atomic<bool> m_aboveHighWater{ false };
+
+		// Chunk pointers are published once and never change; the chunks are owned by
+		// m_receiverLoadChunks, under m_mutexQueue
+		std::unique_ptr<std::atomic<ReceiverLoad_*>[]> m_receiverLoads;
+		std::vector<std::unique_ptr<ReceiverLoad_[]> > m_receiverLoadChunks;
+
+		// MQDOverflowPolicy::Block
+		std::mutex m_mutexSpace;
+		std::condition_variable m_cvSpace;
+		std::atomic<size_t> m_blockedSenders{ 0 };
+		std::atomic<std::thread::id> m_consumerThread{};
+		std::atomic<bool> m_consumerPinned{ true };
+
+		// Metrics.  The consumer's counters have a single writer and are bumped without a
+		// read-modify-write; the senders' ones only move on the (rare) overflow paths
+		std::atomic<uint64_t> m_msgsDequeued{ 0 };
+		std::atomic<uint64_t> m_msgsLost{ 0 };
+		std::atomic<uint64_t> m_msgsDropped{ 0 };
+		std::atomic<uint64_t> m_msgsDroppedNewest{ 0 };
+		std::atomic<uint64_t> m_msgsRejected{ 0 };
+		std::array<std::atomic<uint64_t>, DispatcherMetrics::TIME_IN_QUEUE_BUCKETS> m_timeInQueue{};
+		bool m_sampleTimeInQueue{ false };
+		uint32_t m_sampleMask{ 0 };
+
+		// Serializes the notifications, so listeners see high and low alternate
+		std::mutex m_mutexWaterMark;
+		std::vector<std::shared_ptr<IFlowControlListener> > m_flowControlListeners;
+
+		// True while the consumer is (about to be) suspended; the first sender to take it
+		// sends the wakeup
+		std::atomic<bool> m_signalArmed{ true };
+		std::atomic<uint64_t> m_signalsSent{ 0 };
+		std::atomic<uint64_t> m_signalsSuppressed{ 0 };
 
 		// Local only -- no one should call CreateReceiver from any thread but the one
 		// this dispatcher runs on
-		std::deque <MQDMessageEnvelope> m_localQueue;
-		std::deque<MQDCreateReceiverEnvelope> m_localCreateQueue;
-		std::deque<MQDRemoveReceiverEnvelope> m_localRemoveQueue;
+		std::vector<MQDCreateReceiverEnvelope> m_localCreateQueue;
+		std::vector<MQDRemoveReceiverEnvelope> m_localRemoveQueue;
 
-		std::atomic<ReceiverID> m_freeRcvId;
+		std::atomic<ReceiverID> m_freeRcvId{ 0 };
 		
 		std::unordered_map<ReceiverID,Receiver_>
 			m_receiverMap;
 
+		size_t m_receiverQuantum{ 0 };
+		uint64_t m_processEpoch{ 0 };
+
+		bool m_sameThreadDelivery{ false };
+		size_t m_sameThreadBudget{ 0 };
+		// Both reset per ProcessMessages call
+		size_t m_sameThreadSent{ 0 };
+		bool m_sameThreadAppended{ false };
+
 		bool m_traceLostMessages{ false };
 	};
 
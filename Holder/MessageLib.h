@@ -1,19 +1,29 @@
 #pragma once
 
 #include "Messaging.h"
+#include "MessagePool.h"
 
 namespace holder::messages
 {
 	class SendException { };
 
+	// Messages come out of a per-type pool; the shared_ptr control block shares the allocation
+	template<typename Msg, typename ... Args>
+	std::shared_ptr<Msg> MakeMessage(Args&& ... args)
+	{
+		static_assert(std::is_base_of_v<messages::IMessage, Msg>, "Can only make classes deriving from IMessage");
+		return std::allocate_shared<Msg>(MessagePoolAllocator<Msg>(), std::forward<Args>(args)...);
+	}
+
 	template<typename Msg, typename ... Args>
 	void SendMessage(const std::shared_ptr<messages::ISenderEndpoint>& pCounterpart,
 		Args&& ... args)
 	{
 		static_assert(std::is_base_of_v<messages::IMessage, Msg>, "Can only send classes deriving from IServiceMessage");
-		auto pMsg = std::make_shared<Msg>(std::forward<Args>(args)...);
+		std::shared_ptr<IMessage> pMsg = MakeMessage<Msg>(std::forward<Args>(args)...);
 
-		if (!pCounterpart->SendMessage(pMsg))
+		// Hand over our reference instead of copying it
+		if (!pCounterpart->SendMessage(std::move(pMsg)))
 		{
 			throw SendException();
 		}
@@ -0,0 +1,283 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace holder::messages
+{
+	// Fixed-size block pool for message allocations, one per block size and alignment
+	// Each thread keeps a cache of free blocks and only touches the shared depot a whole
+	// "magazine" at a time.  This matters because messages are usually allocated on the
+	// sending thread and freed on the receiving one, so blocks constantly migrate; the depot
+	// is where they meet again.
+	// Blocks are never returned to the system: the pool grows to the peak number of messages
+	// in flight and stays there
+	template<size_t BlockSize, size_t BlockAlign>
+	class MessageBlockPool
+	{
+	private:
+		static constexpr size_t MAGAZINE_SIZE = 64;
+
+		struct FreeBlock
+		{
+			FreeBlock* pNext;
+		};
+
+		static constexpr size_t ALIGN = BlockAlign > alignof(FreeBlock) ? BlockAlign : alignof(FreeBlock);
+		static constexpr size_t STRIDE = ((BlockSize > sizeof(FreeBlock) ? BlockSize : sizeof(FreeBlock))
+			+ ALIGN - 1) / ALIGN * ALIGN;
+
+		static_assert(ALIGN <= alignof(std::max_align_t), "MessageBlockPool does not handle over-aligned types");
+
+		// A chain of free blocks.  Full-sized except for what a thread leaves behind on exit
+		struct Magazine
+		{
+			FreeBlock* pHead{ nullptr };
+			size_t count{ 0 };
+		};
+
+		class Depot
+		{
+		public:
+			Magazine TakeMagazine()
+			{
+				{
+					std::unique_lock lk(m_mutex);
+					if (!m_magazines.empty())
+					{
+						Magazine magazine = m_magazines.back();
+						m_magazines.pop_back();
+						return magazine;
+					}
+				}
+
+				// Nothing to recycle: carve a new slab
+				return CarveSlab();
+			}
+
+			void ReturnMagazine(const Magazine& magazine)
+			{
+				std::unique_lock lk(m_mutex);
+				m_magazines.push_back(magazine);
+			}
+
+			// One block at a time, for threads whose cache is already gone
+			void* TakeBlock()
+			{
+				{
+					std::unique_lock lk(m_mutex);
+					if (m_loose.count == 0 && !m_magazines.empty())
+					{
+						m_loose = m_magazines.back();
+						m_magazines.pop_back();
+					}
+					if (m_loose.count > 0)
+					{
+						return PopBlock(m_loose);
+					}
+				}
+
+				Magazine slab = CarveSlab();
+				void* pBlock = PopBlock(slab);
+				ReturnMagazine(slab);
+				return pBlock;
+			}
+
+			void ReturnBlock(void* pMem)
+			{
+				std::unique_lock lk(m_mutex);
+				auto pBlock = static_cast<FreeBlock*>(pMem);
+				pBlock->pNext = m_loose.pHead;
+				m_loose.pHead = pBlock;
+				if (++m_loose.count == MAGAZINE_SIZE)
+				{
+					m_magazines.push_back(m_loose);
+					m_loose = Magazine{};
+				}
+			}
+
+		private:
+			static Magazine CarveSlab()
+			{
+				auto pSlab = static_cast<unsigned char*>(::operator new(STRIDE * MAGAZINE_SIZE));
+				Magazine magazine;
+				for (size_t i = MAGAZINE_SIZE; i > 0; --i)
+				{
+					auto pBlock = new (pSlab + STRIDE * (i - 1)) FreeBlock;
+					pBlock->pNext = magazine.pHead;
+					magazine.pHead = pBlock;
+				}
+				magazine.count = MAGAZINE_SIZE;
+				return magazine;
+			}
+
+			static void* PopBlock(Magazine& magazine)
+			{
+				FreeBlock* pBlock = magazine.pHead;
+				magazine.pHead = pBlock->pNext;
+				--magazine.count;
+				return pBlock;
+			}
+
+			std::mutex m_mutex;
+			std::vector<Magazine> m_magazines;
+			// Single blocks from TakeBlock and ReturnBlock, gathered into a magazine
+			Magazine m_loose;
+		};
+
+		class ThreadCache
+		{
+		public:
+			~ThreadCache()
+			{
+				// Give everything back so that other threads can use it
+				if (m_cache.count > 0)
+				{
+					GetDepot().ReturnMagazine(m_cache);
+				}
+				m_cache = Magazine{};
+
+				// Messages may still be freed (or even allocated) on this thread, e.g. by the
+				// destructors of static singletons on the main thread
+				IsThreadCacheGone() = true;
+			}
+
+			void* Pop()
+			{
+				if (m_cache.count == 0)
+				{
+					m_cache = GetDepot().TakeMagazine();
+				}
+
+				FreeBlock* pBlock = m_cache.pHead;
+				m_cache.pHead = pBlock->pNext;
+				--m_cache.count;
+				return pBlock;
+			}
+
+			void Push(void* pMem)
+			{
+				auto pBlock = static_cast<FreeBlock*>(pMem);
+				pBlock->pNext = m_cache.pHead;
+				m_cache.pHead = pBlock;
+				++m_cache.count;
+
+				// Keep one magazine's worth locally so that alloc/free pairs on one thread
+				// never reach the depot
+				if (m_cache.count >= 2 * MAGAZINE_SIZE)
+				{
+					GetDepot().ReturnMagazine(SplitMagazine());
+				}
+			}
+
+		private:
+			// Detach MAGAZINE_SIZE blocks from the front of the cache
+			Magazine SplitMagazine()
+			{
+				Magazine magazine;
+				magazine.pHead = m_cache.pHead;
+				magazine.count = MAGAZINE_SIZE;
+
+				FreeBlock* pLast = m_cache.pHead;
+				for (size_t i = 1; i < MAGAZINE_SIZE; ++i)
+				{
+					pLast = pLast->pNext;
+				}
+				m_cache.pHead = pLast->pNext;
+				m_cache.count -= MAGAZINE_SIZE;
+				pLast->pNext = nullptr;
+				return magazine;
+			}
+
+			Magazine m_cache;
+		};
+
+		static Depot& GetDepot()
+		{
+			// Deliberately leaked: thread caches may be torn down after static destructors run
+			static Depot* pDepot = new Depot();
+			return *pDepot;
+		}
+
+		static ThreadCache& GetThreadCache()
+		{
+			thread_local ThreadCache cache;
+			return cache;
+		}
+
+		// Trivially destructible, so it can still be read once the cache has been destroyed
+		static bool& IsThreadCacheGone()
+		{
+			thread_local bool gone{ false };
+			return gone;
+		}
+
+	public:
+		static void* Allocate()
+		{
+			if (IsThreadCacheGone())
+			{
+				return GetDepot().TakeBlock();
+			}
+			return GetThreadCache().Pop();
+		}
+
+		static void Deallocate(void* pMem)
+		{
+			if (IsThreadCacheGone())
+			{
+				GetDepot().ReturnBlock(pMem);
+				return;
+			}
+			GetThreadCache().Push(pMem);
+		}
+	};
+
+	// Standard allocator front end, meant for std::allocate_shared.  The shared_ptr control
+	// block and the message then live in one pooled block per message type
+	template<typename T>
+	class MessagePoolAllocator
+	{
+	public:
+		using value_type = T;
+
+		MessagePoolAllocator() noexcept = default;
+
+		template<typename U>
+		MessagePoolAllocator(const MessagePoolAllocator<U>&) noexcept { }
+
+		T* allocate(size_t n)
+		{
+			if constexpr (alignof(T) <= alignof(std::max_align_t))
+			{
+				if (n == 1)
+				{
+					return static_cast<T*>(MessageBlockPool<sizeof(T), alignof(T)>::Allocate());
+				}
+			}
+			return std::allocator<T>().allocate(n);
+		}
+
+		void deallocate(T* p, size_t n)
+		{
+			if constexpr (alignof(T) <= alignof(std::max_align_t))
+			{
+				if (n == 1)
+				{
+					MessageBlockPool<sizeof(T), alignof(T)>::Deallocate(p);
+					return;
+				}
+			}
+			std::allocator<T>().deallocate(p, n);
+		}
+
+		template<typename U>
+		bool operator==(const MessagePoolAllocator<U>&) const noexcept { return true; }
+		template<typename U>
+		bool operator!=(const MessagePoolAllocator<U>&) const noexcept { return false; }
+	};
+
+}
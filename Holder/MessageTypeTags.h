@@ -4,24 +4,66 @@
 
 namespace holder::base::constants
 {
+	// Keys for the common message tags; the names are what other processes see
+	namespace tagkeys
+	{
+		struct DestroyMessage { static constexpr const char* TYPE_TAG_NAME = "/messages/core/DestroyMessage"; };
+		struct ServiceMessage { static constexpr const char* TYPE_TAG_NAME = "/messages/core/ServiceMessage"; };
+		struct OutgoingRequest { static constexpr const char* TYPE_TAG_NAME = "/messages/core/OutgoingRequest"; };
+		struct IncomingRequest { static constexpr const char* TYPE_TAG_NAME = "/messages/core/IncomingRequest"; };
+		struct CreateProxyMessage { static constexpr const char* TYPE_TAG_NAME = "/messages/core/CreateProxyMessage"; };
+		struct RequestOutgoingMessage { static constexpr const char* TYPE_TAG_NAME = "/messages/core/RequestOutgoingMessage"; };
+		struct RequestIncomingMessage { static constexpr const char* TYPE_TAG_NAME = "/messages/core/RequestIncomingMessage"; };
+		struct SCommClientMessage { static constexpr const char* TYPE_TAG_NAME = "/messages/core/SCommClientMessage"; };
+		struct SCommServiceMessage { static constexpr const char* TYPE_TAG_NAME = "/messages/core/SCommServiceMessage"; };
+	}
+
 	// Declarations of common type tags for messages
+	// Inline, so a GetTag() override compiles down to the load of one static
 	
-	types::TypeTag GetDestroyMessageTag();
+	inline types::TypeTag GetDestroyMessageTag()
+	{
+		return types::TypeTagOf<tagkeys::DestroyMessage>();
+	}
 
-	types::TypeTag GetServiceMessageTag();
+	inline types::TypeTag GetServiceMessageTag()
+	{
+		return types::TypeTagOf<tagkeys::ServiceMessage>();
+	}
 
-	types::TypeTag GetOutgoingRequestTag();
+	inline types::TypeTag GetOutgoingRequestTag()
+	{
+		return types::TypeTagOf<tagkeys::OutgoingRequest>();
+	}
 
-	types::TypeTag GetIncomingRequestTag();
+	inline types::TypeTag GetIncomingRequestTag()
+	{
+		return types::TypeTagOf<tagkeys::IncomingRequest>();
+	}
 
-	types::TypeTag GetCreateProxyMessageTag();
+	inline types::TypeTag GetCreateProxyMessageTag()
+	{
+		return types::TypeTagOf<tagkeys::CreateProxyMessage>();
+	}
 
-	types::TypeTag GetRequestOutgoingMessageTag();
+	inline types::TypeTag GetRequestOutgoingMessageTag()
+	{
+		return types::TypeTagOf<tagkeys::RequestOutgoingMessage>();
+	}
 
-	types::TypeTag GetRequestIncomingMessageTag();
+	inline types::TypeTag GetRequestIncomingMessageTag()
+	{
+		return types::TypeTagOf<tagkeys::RequestIncomingMessage>();
+	}
 
-	types::TypeTag GetSCommClientMessageTag();
+	inline types::TypeTag GetSCommClientMessageTag()
+	{
+		return types::TypeTagOf<tagkeys::SCommClientMessage>();
+	}
 
-	types::TypeTag GetSCommServiceMessageTag();
+	inline types::TypeTag GetSCommServiceMessageTag()
+	{
+		return types::TypeTagOf<tagkeys::SCommServiceMessage>();
+	}
 
-}
\ No newline at end of file
+}
@@ -1,10 +1,14 @@
 #pragma once
 
 #include "IAppObject.h"
+#include "IExecutor.h"
 #include "TypeTags.h"
 
+#include <array>
 #include <cinttypes>
+#include <cstddef>
 #include <memory>
+#include <vector>
 
 namespace holder::messages
 {
@@ -13,19 +17,108 @@ namespace holder::messages
 	using ReceiverID = uint32_t;
 	using QueueID = uint32_t;
 
+	// Higher is more urgent.  Dispatchers with fewer priority lanes fold the excess into
+	// their most urgent lane
+	using MessagePriority = uint8_t;
+	constexpr MessagePriority PRIORITY_NORMAL = 0;
+	constexpr MessagePriority PRIORITY_HIGH = 1;
+
+	// For flow control notifications that concern a whole dispatcher rather than one receiver
+	constexpr ReceiverID ALL_RECEIVERS = UINT32_MAX;
+
+	// What became of a message handed to a dispatcher with bounded queues
+	enum class SendResult
+	{
+		Queued,
+		// Queued, but over capacity: older messages will be discarded to make room
+		QueuedDroppingOldest,
+		// Over capacity: the message was discarded
+		DroppedNewest,
+		// Over capacity: nothing was queued
+		Rejected
+	};
+
+	inline bool IsQueued(SendResult result)
+	{
+		return result == SendResult::Queued || result == SendResult::QueuedDroppingOldest;
+	}
+
+	struct ReceiverMetrics
+	{
+		ReceiverID id{ 0 };
+		uint64_t messagesDequeued{ 0 };
+		uint64_t messagesDropped{ 0 };
+		// Only tracked when the dispatcher has per-receiver capacities
+		size_t queueDepth{ 0 };
+	};
+
+	// Counters since the dispatcher was created.  Each one is exact, but they are read one
+	// at a time, so a snapshot taken under load need not add up
+	struct DispatcherMetrics
+	{
+		// Bucket i counts messages that waited less than 2^i microseconds, except for the last
+		// one, which takes everything longer
+		static constexpr size_t TIME_IN_QUEUE_BUCKETS = 24;
+
+		// Handed to a receiver, or lost because there was no such receiver
+		uint64_t messagesDequeued{ 0 };
+		uint64_t messagesLost{ 0 };
+		// Discarded from the queue to make room for newer messages
+		uint64_t messagesDropped{ 0 };
+		// Turned away at the door
+		uint64_t messagesDroppedNewest{ 0 };
+		uint64_t messagesRejected{ 0 };
+		size_t queueDepth{ 0 };
+		// Sampled, so the counts are a fraction of messagesDequeued
+		std::array<uint64_t, TIME_IN_QUEUE_BUCKETS> timeInQueue{};
+		// Live receivers only
+		std::vector<ReceiverMetrics> receivers;
+	};
+
 	class MessageException { };
 
 	class IMessage : public base::IAppObject
 	{
 	public:
 		virtual base::types::TypeTag GetTag() const = 0;
+		virtual MessagePriority GetPriority() const { return PRIORITY_NORMAL; }
+	};
+
+	// A non-owning view of a contiguous run of messages, for batched sends
+	class MessageSpan
+	{
+	public:
+		using Element = std::shared_ptr<IMessage>;
+
+		MessageSpan(const Element* pMessages, size_t count)
+			:m_pMessages(pMessages),
+			m_count(count)
+		{ }
+
+		// Any contiguous container: std::vector, std::array...
+		template<typename Container>
+		MessageSpan(const Container& messages)
+			:m_pMessages(messages.data()),
+			m_count(messages.size())
+		{ }
+
+		const Element* begin() const { return m_pMessages; }
+		const Element* end() const { return m_pMessages + m_count; }
+		size_t size() const { return m_count; }
+		bool empty() const { return m_count == 0; }
+		const Element& operator[](size_t idx) const { return m_pMessages[idx]; }
+
+	private:
+		const Element* m_pMessages;
+		size_t m_count;
 	};
 
 	class ISenderEndpoint : public base::IAppObject
 	{
 	public:
-		// TODO:  Support sending batches
 		virtual bool SendMessage(std::shared_ptr<IMessage> pMsg) = 0;
+		// All or nothing: the batch is queued in order, with at most one wakeup
+		virtual bool SendMessages(MessageSpan messages) = 0;
 	};
 
 	class IMessageListener : public base::IAppObject
@@ -44,6 +137,16 @@ namespace holder::messages
 		virtual bool CanSendMessage(const IMessage& msg) = 0;
 	};
 
+	// Lets producers slow down before a dispatcher's limits are hit.  Called on whichever
+	// thread crossed the mark, one notification at a time; do not send to the dispatcher from here
+	class IFlowControlListener : public base::IAppObject
+	{
+	public:
+		// rcvrId is ALL_RECEIVERS when the mark is the dispatcher's own
+		virtual void OnHighWater(ReceiverID rcvrId) = 0;
+		virtual void OnLowWater(ReceiverID rcvrId) = 0;
+	};
+
 	struct CreateReceiverArgs
 	{
 		std::shared_ptr<IMessageListener> pListener;
@@ -59,9 +162,23 @@ namespace holder::messages
 				std::shared_ptr<IMessageFilter> pFilter,
 				DispatchID dispatchId) = 0;
 		virtual void RemoveReceiver(ReceiverID rcvrId) = 0;
-		virtual void SendMessage(ReceiverID rcvrId, std::shared_ptr<IMessage> pMessage)
+		virtual SendResult SendMessage(ReceiverID rcvrId, std::shared_ptr<IMessage> pMessage)
 			= 0;
+		// Overrides the message's own priority, e.g. for an endpoint dedicated to urgent traffic
+		virtual SendResult SendMessage(ReceiverID rcvrId, std::shared_ptr<IMessage> pMessage,
+			MessagePriority priority) = 0;
+		// Capacity is reserved for the batch as a whole
+		virtual SendResult SendMessages(ReceiverID rcvrId, MessageSpan messages) = 0;
+		// Overrides the priority of every message in the batch
+		virtual SendResult SendMessages(ReceiverID rcvrId, MessageSpan messages,
+			MessagePriority priority) = 0;
+		virtual void AddFlowControlListener(const std::shared_ptr<IFlowControlListener>& pListener) = 0;
+		virtual void RemoveFlowControlListener(const std::shared_ptr<IFlowControlListener>& pListener) = 0;
 		virtual const char* GetExecutionThreadName() const = 0;
+		// The executor that runs the dispatcher, or EXEC_WILDCARD if none does
+		virtual base::ExecutorID GetExecutorID() const = 0;
+		// Any thread
+		virtual void GetMetrics(DispatcherMetrics& rMetrics) const = 0;
 	};
 
 }
\ No newline at end of file
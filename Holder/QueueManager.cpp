@@ -0,0 +1,262 @@
+#include "QueueManager.h"
+#include "ExecutionManager.h"
+
+#include <mutex>
+
+namespace impl_ns = holder::messages;
+
+impl_ns::SenderEndpoint::SenderEndpoint(IMessageDispatcher* pDispatcher,
+	ReceiverID receiverId,
+	const std::atomic<uint32_t>* pGeneration,
+	std::shared_ptr<IMessageFilter> pFilter,
+	std::optional<MessagePriority> priority)
+	:m_pDispatcher(pDispatcher),
+	m_pGeneration(pGeneration),
+	m_generation(pGeneration->load()),
+	m_receiverId(receiverId),
+	m_pFilter(std::move(pFilter)),
+	m_priority(priority)
+{
+
+}
+
+bool impl_ns::SenderEndpoint::SendMessage(std::shared_ptr<IMessage> pMsg)
+{
+	if (!IsCurrent())
+	{
+		return false;
+	}
+
+	if (m_pFilter && !m_pFilter->CanSendMessage(*pMsg))
+	{
+		return false;
+	}
+
+	SendResult result = m_priority.has_value()
+		? m_pDispatcher->SendMessage(m_receiverId, std::move(pMsg), m_priority.value())
+		: m_pDispatcher->SendMessage(m_receiverId, std::move(pMsg));
+
+	return IsQueued(result);
+}
+
+bool impl_ns::SenderEndpoint::SendMessages(MessageSpan messages)
+{
+	if (!IsCurrent())
+	{
+		return false;
+	}
+
+	if (m_pFilter)
+	{
+		for (const auto& pMsg : messages)
+		{
+			if (!m_pFilter->CanSendMessage(*pMsg))
+			{
+				return false;
+			}
+		}
+	}
+
+	SendResult result = m_priority.has_value()
+		? m_pDispatcher->SendMessages(m_receiverId, messages, m_priority.value())
+		: m_pDispatcher->SendMessages(m_receiverId, messages);
+
+	return IsQueued(result);
+}
+
+impl_ns::QueueManager::QueueManager()
+#ifdef _DEBUG
+	:m_filterOnSend(true)
+#else
+	:m_filterOnSend(false)
+#endif
+{
+	// QueueID zero is never handed out
+	m_queues.emplace_back();
+	m_tables.emplace_back(std::make_unique<QueueTable_>(INITIAL_TABLE_CAPACITY));
+	m_pTable.store(m_tables.back().get());
+}
+
+impl_ns::QueueManager& impl_ns::QueueManager::GetInstance()
+{
+	static QueueManager me;
+	return me;
+}
+
+impl_ns::QueueID impl_ns::QueueManager::AddQueue(const char* pQueueName,
+	std::shared_ptr<IMessageDispatcher> pQueue)
+{
+	std::unique_lock lk(m_mutex);
+
+	if (m_queueNames.count(pQueueName) > 0)
+	{
+		throw DuplicateQueueException();
+	}
+
+	QueueID newQueueID = static_cast<QueueID>(m_queues.size());
+	QueueTable_* pTable = m_tables.back().get();
+
+	if (newQueueID >= pTable->capacity)
+	{
+		// Readers may still be on the old table, so it is kept rather than freed
+		auto pNewTable = std::make_unique<QueueTable_>(pTable->capacity * 2);
+		for (size_t i = 0; i < pTable->capacity; ++i)
+		{
+			pNewTable->pQueues[i].store(pTable->pQueues[i].load(std::memory_order_relaxed),
+				std::memory_order_relaxed);
+		}
+
+		pTable = pNewTable.get();
+		m_tables.emplace_back(std::move(pNewTable));
+		m_pTable.store(pTable, std::memory_order_release);
+	}
+
+	IMessageDispatcher* pRawQueue = pQueue.get();
+	m_queues.emplace_back(std::move(pQueue));
+	m_queueNames.emplace(pQueueName, newQueueID);
+	pTable->pQueues[newQueueID].store(pRawQueue, std::memory_order_release);
+
+	return newQueueID;
+}
+
+const std::shared_ptr<impl_ns::IMessageDispatcher>&
+	impl_ns::QueueManager::GetQueue(const char* pQueueName, QueueID& rQueueId)
+{
+	static const std::shared_ptr<IMessageDispatcher> noQueue;
+
+	std::shared_lock lk(m_mutex);
+
+	auto itName = m_queueNames.find(pQueueName);
+	if (itName == m_queueNames.end())
+	{
+		return noQueue;
+	}
+
+	rQueueId = itName->second;
+	return m_queues[itName->second];
+}
+
+std::shared_ptr<impl_ns::ISenderEndpoint>
+	impl_ns::QueueManager::CreateEndpoint(QueueID queueId, ReceiverID receiverID,
+		std::optional<MessagePriority> priority)
+{
+	std::shared_lock lk(m_mutex);
+
+	// Only receivers created here can tell their endpoints that they are gone
+	auto itReceiver = m_receivers.find(ReceiverKey(queueId, receiverID));
+	if (itReceiver == m_receivers.end())
+	{
+		return nullptr;
+	}
+
+	const Receiver_& receiver = itReceiver->second;
+
+	return std::make_shared<SenderEndpoint>(m_queues[queueId].get(), 
+		receiverID,
+		&m_generations[receiver.generationSlot],
+		m_filterOnSend ? receiver.pFilter : nullptr,
+		priority);
+}
+
+bool impl_ns::QueueManager::SendMessage(QueueID queueID, ReceiverID receiverID,
+	const std::shared_ptr<messages::IMessage>& pMessage)
+{
+	IMessageDispatcher* pQueue = FindQueue(queueID);
+	if (!pQueue)
+	{
+		return false;
+	}
+
+	return IsQueued(pQueue->SendMessage(receiverID, pMessage));
+}
+
+impl_ns::ReceiverID impl_ns::QueueManager::CreateReceiver(QueueID queueId,
+	const CreateReceiverArgs& recvrArgs)
+{
+	IMessageDispatcher* pQueue = FindQueue(queueId);
+	if (!pQueue)
+	{
+		throw QueueNotFoundException();
+	}
+
+	ReceiverID rcvrId = pQueue->CreateReceiver(recvrArgs.pListener,
+		recvrArgs.pFilter,
+		recvrArgs.dispatchId);
+
+	std::unique_lock lk(m_mutex);
+
+	size_t generationSlot;
+	if (!m_freeGenerations.empty())
+	{
+		generationSlot = m_freeGenerations.back();
+		m_freeGenerations.pop_back();
+	}
+	else
+	{
+		generationSlot = m_generations.size();
+		m_generations.emplace_back(0);
+	}
+
+	m_receivers.emplace(ReceiverKey(queueId, rcvrId), Receiver_{ generationSlot, recvrArgs.pFilter });
+
+	return rcvrId;
+}
+
+void impl_ns::QueueManager::RemoveReceiver(QueueID queueId, ReceiverID rcvrId)
+{
+	IMessageDispatcher* pQueue = FindQueue(queueId);
+	if (!pQueue)
+	{
+		return;
+	}
+
+	{
+		std::unique_lock lk(m_mutex);
+
+		auto itReceiver = m_receivers.find(ReceiverKey(queueId, rcvrId));
+		if (itReceiver != m_receivers.end())
+		{
+			size_t generationSlot = itReceiver->second.generationSlot;
+			m_generations[generationSlot].fetch_add(1);
+			m_freeGenerations.push_back(generationSlot);
+			m_receivers.erase(itReceiver);
+		}
+	}
+
+	pQueue->RemoveReceiver(rcvrId);
+}
+
+void impl_ns::QueueManager::SetFilterOnSend(bool filterOnSend)
+{
+	std::unique_lock lk(m_mutex);
+	m_filterOnSend = filterOnSend;
+}
+
+bool impl_ns::QueueManager::IsOnSameThread(QueueID queueIdA, QueueID queueIdB)
+{
+	IMessageDispatcher* pQueueA = FindQueue(queueIdA);
+	IMessageDispatcher* pQueueB = FindQueue(queueIdB);
+
+	if (!pQueueA || !pQueueB)
+	{
+		return false;
+	}
+
+	// A thread name is no guide in the executor pool, where executors sharing one run on
+	// several workers
+	return pQueueA == pQueueB
+		|| base::ExecutionManager::GetInstance().AreOnSameThread(pQueueA->GetExecutorID(),
+			pQueueB->GetExecutorID());
+}
+
+bool impl_ns::QueueManager::GetQueueMetrics(QueueID queueId, DispatcherMetrics& rMetrics)
+{
+	IMessageDispatcher* pQueue = FindQueue(queueId);
+	if (!pQueue)
+	{
+		return false;
+	}
+
+	pQueue->GetMetrics(rMetrics);
+	return true;
+}
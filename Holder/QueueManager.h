@@ -2,50 +2,157 @@
 
 #include "Messaging.h"
 
+#include <atomic>
 #include <cinttypes>
+#include <deque>
+#include <memory>
+#include <optional>
 #include <shared_mutex>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace holder::messages
 {
 
+	class DuplicateQueueException { };
+
+	class QueueNotFoundException { };
+
+	// Everything an endpoint needs is resolved when it is created.  A send checks that the
+	// receiver's generation has not moved on (it moves when the receiver is removed) and goes
+	// straight to the dispatcher; the receiver's filter only runs if filtering was on when the
+	// endpoint was created
 	class SenderEndpoint : public ISenderEndpoint
 	{
 	public:
-		bool SendMessage(const std::shared_ptr<IMessage>& pMsg) override;
+		SenderEndpoint(IMessageDispatcher* pDispatcher,
+			ReceiverID receiverId,
+			const std::atomic<uint32_t>* pGeneration,
+			std::shared_ptr<IMessageFilter> pFilter,
+			std::optional<MessagePriority> priority);
+
+		bool SendMessage(std::shared_ptr<IMessage> pMsg) override;
+		bool SendMessages(MessageSpan messages) override;
 	private:
-		std::shared_ptr<IMessageDispatcher> m_pDispatcher;
+		bool IsCurrent() const
+		{
+			// A send that races the removal is lost at the dispatcher, as it would have been
+			// had it come a little earlier
+			return m_pGeneration->load(std::memory_order_relaxed) == m_generation;
+		}
+
+		// Both owned by the QueueManager, which never frees them
+		IMessageDispatcher* m_pDispatcher;
+		const std::atomic<uint32_t>* m_pGeneration;
+		uint32_t m_generation;
 		ReceiverID m_receiverId;
+		// Null unless filtering on send
+		std::shared_ptr<IMessageFilter> m_pFilter;
+		// When set, used instead of each message's own priority
+		std::optional<MessagePriority> m_priority;
 	};
 
+	// Queues are only ever added, so a QueueID indexes a table that senders read without a
+	// lock.  Growing the table publishes a copy; the old copies stay around until the manager
+	// goes away, so a reader that loaded one just before the switch is never left dangling.
+	// Names are only for setup and go through the mutex
 	class QueueManager
 	{
+	private:
+		struct QueueTable_
+		{
+			QueueTable_(size_t capacity_)
+				:pQueues(new std::atomic<IMessageDispatcher*>[capacity_]),
+				capacity(capacity_)
+			{
+				for (size_t i = 0; i < capacity; ++i)
+				{
+					pQueues[i].store(nullptr, std::memory_order_relaxed);
+				}
+			}
 
-	public:
-		QueueManager& GetInstance();
+			std::unique_ptr<std::atomic<IMessageDispatcher*>[]> pQueues;
+			size_t capacity;
+		};
+
+		static constexpr size_t INITIAL_TABLE_CAPACITY = 64;
+
+		// Receivers created through the manager, for the endpoints
+		struct Receiver_
+		{
+			// Into m_generations
+			size_t generationSlot;
+			std::shared_ptr<IMessageFilter> pFilter;
+		};
 
-		QueueID AddQueue(const char* pQueueName, 
+	public:
+		QueueID AddQueue(const char* pQueueName,
 			std::shared_ptr<IMessageDispatcher> pQueue);
 
+		// Empty if there is no such queue, in which case rQueueId is left alone
 		const std::shared_ptr<IMessageDispatcher>& GetQueue(const char* pQueueName, QueueID& rQueueId);
 
-		std::shared_ptr<ISenderEndpoint> CreateEndpoint(QueueID queueId, ReceiverID receiverID);
+		// With a priority, the endpoint sends everything at that priority, e.g. for a channel
+		// dedicated to urgent traffic; otherwise each message goes at its own
+		std::shared_ptr<ISenderEndpoint> CreateEndpoint(QueueID queueId, ReceiverID receiverID,
+			std::optional<MessagePriority> priority = std::nullopt);
 
-		// Direct send
+		// Direct send.  Takes no lock
 		bool SendMessage(QueueID queueID, ReceiverID receiverID,
 			const std::shared_ptr<messages::IMessage>& pMessage);
 
 		// Dispatch interface
 		ReceiverID CreateReceiver(QueueID queueId, const CreateReceiverArgs& recvrArgs);
+		// Endpoints to the receiver stop sending
 		void RemoveReceiver(QueueID queueId, ReceiverID rcvrId);
-		
+
+		// Whether endpoints created from now on run the receiver's filter on each message.
+		// On by default in debug builds
+		void SetFilterOnSend(bool filterOnSend);
+
+		// True only if the two queues can never be processed at the same time, so that one
+		// may call into the other's receivers directly
 		bool IsOnSameThread(QueueID queueIdA, QueueID queueIDB);
 
+		// For monitoring; false if there is no such queue
+		bool GetQueueMetrics(QueueID queueId, DispatcherMetrics& rMetrics);
+
 		static QueueManager& GetInstance();
 	private:
 		QueueManager();
 
+		static uint64_t ReceiverKey(QueueID queueId, ReceiverID rcvrId)
+		{
+			return (static_cast<uint64_t>(queueId) << 32) | rcvrId;
+		}
+
+		IMessageDispatcher* FindQueue(QueueID queueId) const
+		{
+			const QueueTable_* pTable = m_pTable.load(std::memory_order_acquire);
+			if (queueId >= pTable->capacity)
+			{
+				return nullptr;
+			}
+			return pTable->pQueues[queueId].load(std::memory_order_acquire);
+		}
+
+		// Setup: names, ownership and the writer's side of the table
 		std::shared_mutex m_mutex;
+		std::unordered_map<std::string, QueueID> m_queueNames;
+		// Indexed by QueueID; a deque, so GetQueue can hand out references
+		std::deque<std::shared_ptr<IMessageDispatcher> > m_queues;
+		std::vector<std::unique_ptr<QueueTable_> > m_tables;
+
+		std::unordered_map<uint64_t, Receiver_> m_receivers;
+		// One counter per live receiver, bumped on removal and then reused.  A deque, so the
+		// endpoints' pointers stay put
+		std::deque<std::atomic<uint32_t> > m_generations;
+		std::vector<size_t> m_freeGenerations;
+		bool m_filterOnSend;
+
+		// The latest of m_tables
+		std::atomic<QueueTable_*> m_pTable;
 	};
 
-}
\ No newline at end of file
+}
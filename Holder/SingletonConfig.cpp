@@ -1,11 +1,13 @@
 #include "SingletonConfig.h"
 #include <cstring>
 
-std::chrono::microseconds holder::base::SingletonConfig::GetDurationUS(const char* key)
+uint64_t holder::base::SingletonConfig::GetUnsignedInt(const char* key)
 {
-	if (!strcmp(key, "execution_microsecond_wait"))
+	// Worker threads for executors that are not singletons; zero keeps every executor on
+	// its named thread
+	if (!strcmp(key, "execution_pool_threads"))
 	{
-		return std::chrono::microseconds(100);
+		return 0;
 	}
 
 	throw UnknownSingletonKeyException();
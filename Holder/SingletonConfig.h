@@ -12,7 +12,6 @@ namespace holder::base
 		uint64_t GetUnsignedInt(const char* key);
 		int64_t GetSignedInt(const char* key);
 		const std::string GetString(const char* key);
-		std::chrono::microseconds GetDurationUS(const char* key);
 		std::chrono::milliseconds GetDurationMS(const char* key);
 	};
 }
\ No newline at end of file
@@ -359,7 +359,7 @@ impl_ns::StartupTaskID impl_ns::StartupTaskManager::DefineStartupTask(const char
 
 	if (m_running)
 	{
-		ExecutionManager::GetInstance().SignalExecutor(m_execID,
+		ExecutionManager::GetInstance().SignalExecutor(m_execHandle,
 			ExecutorSignalType::WakeUp);
 	}
 
@@ -383,7 +383,7 @@ void impl_ns::StartupTaskManager::SetStartupDependencies(StartupTaskID taskId, c
 
 	if (m_running)
 	{
-		ExecutionManager::GetInstance().SignalExecutor(m_execID,
+		ExecutionManager::GetInstance().SignalExecutor(m_execHandle,
 			ExecutorSignalType::WakeUp);
 	}
 }
@@ -404,7 +404,7 @@ void impl_ns::StartupTaskManager::RunTask(StartupTaskID taskId)
 
 	if (m_running)
 	{
-		ExecutionManager::GetInstance().SignalExecutor(m_execID,
+		ExecutionManager::GetInstance().SignalExecutor(m_execHandle,
 			ExecutorSignalType::WakeUp);
 	}
 }
@@ -424,7 +424,7 @@ void impl_ns::StartupTaskManager::CompleteTask(StartupTaskID taskId, bool succes
 
 	if (m_running)
 	{
-		ExecutionManager::GetInstance().SignalExecutor(m_execID,
+		ExecutionManager::GetInstance().SignalExecutor(m_execHandle,
 			ExecutorSignalType::WakeUp);
 	}
 }
@@ -438,7 +438,7 @@ void impl_ns::StartupTaskManager::StartExecutor(bool stopWhenComplete)
 			= std::make_shared<StartupTaskExecutor>(stopWhenComplete);
 		// Start the startup thread
 		// "singleton" means this executor has this thread exclusively
-		m_execID = ExecutionManager::GetInstance().AddExecutor(startupThread_, m_pMyExecutor, true);
+		m_execHandle = ExecutionManager::GetInstance().AddExecutor(startupThread_, m_pMyExecutor, true);
 		m_running = true;
 	}
 }
@@ -192,7 +192,7 @@ namespace holder::base::startup
 		std::mutex m_mutex;
 
 		std::shared_ptr<StartupTaskExecutor> m_pMyExecutor;
-		ExecutorID m_execID;
+		ExecutorHandle m_execHandle;
 		bool m_running{ false };
 		StartupTaskID m_nextTaskId{ 0 };
 		std::deque<std::shared_ptr<IStartupAction> > m_executorQueue;
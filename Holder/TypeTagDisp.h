@@ -2,16 +2,31 @@
 
 #include "TypeTags.h"
 
-#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
 
 namespace holder::base::types
 {
 	class DuplicateTagException { };
 
+	// TypeIDs are handed out densely, so most tags land in a flat table indexed by TypeID.
+	// It holds 16-bit positions in m_members rather than the member pointers themselves, so
+	// that it stays small when a subject's tags are spread among many others.  A tag that
+	// would stretch it well past the number of entries goes into a small sorted table instead
 	template<typename Subject, typename Object,
 		typename ... Satellites>
 	class TypeTagsDisp
 	{
+	private:
+		// The flat table may be this many times larger than the number of entries...
+		static constexpr size_t FLAT_GROWTH = 64;
+		// ...or this large, whichever is more
+		static constexpr size_t FLAT_MINIMUM = 1024;
+		// Position zero in the flat table means no dispatch
+		static constexpr size_t MAX_FLAT_ENTRIES = UINT16_MAX;
+
 	public:
 		using DispMember = void (Subject::*)(Object&, Satellites...);
 
@@ -30,12 +45,30 @@ namespace holder::base::types
 		void AddDispatch(const TypeTag& tag,
 			DispMember dispMember)
 		{
-			auto emplResult = m_dispatchTable.emplace(tag, dispMember);
+			TypeID typeId = tag.GetID();
 
-			if (!emplResult.second)
+			if (FindDispatch(typeId))
 			{
 				throw DuplicateTagException();
 			}
+
+			++m_entryCount;
+			if (m_members.size() < MAX_FLAT_ENTRIES
+				&& (typeId < m_flatTable.size()
+					|| typeId < std::max(FLAT_MINIMUM, m_entryCount * FLAT_GROWTH)))
+			{
+				if (typeId >= m_flatTable.size())
+				{
+					GrowFlatTable(typeId + 1);
+				}
+				AddFlat(typeId, dispMember);
+			}
+			else
+			{
+				auto itSparse = std::lower_bound(m_sparseTable.begin(), m_sparseTable.end(), typeId,
+					[](const SparseEntry& entry, TypeID id) { return entry.first < id; });
+				m_sparseTable.emplace(itSparse, typeId, dispMember);
+			}
 		}
 
 		template<typename ... Args>
@@ -50,13 +83,11 @@ namespace holder::base::types
 				return false;
 			}
 			
-			auto itObj = m_dispatchTable.find(tag);
-			if (itObj == m_dispatchTable.end())
+			DispMember callPtr = FindDispatch(tag.GetID());
+			if (!callPtr)
 			{
 				return false;
 			}
-
-			DispMember callPtr = itObj->second;
 			
 			(pThis->*callPtr)(obj, std::forward<Args>(args)...);
 			
@@ -64,8 +95,54 @@ namespace holder::base::types
 		}
 
 	private:
-		std::unordered_map<TypeTag, DispMember>
-			m_dispatchTable;
+		using SparseEntry = std::pair<TypeID, DispMember>;
+
+		DispMember FindDispatch(TypeID typeId) const
+		{
+			if (typeId < m_flatTable.size())
+			{
+				uint16_t memberPos = m_flatTable[typeId];
+				return memberPos != 0 ? m_members[memberPos - 1] : nullptr;
+			}
+
+			if (m_sparseTable.empty())
+			{
+				return nullptr;
+			}
+
+			auto itSparse = std::lower_bound(m_sparseTable.begin(), m_sparseTable.end(), typeId,
+				[](const SparseEntry& entry, TypeID id) { return entry.first < id; });
+			return itSparse != m_sparseTable.end() && itSparse->first == typeId ? itSparse->second : nullptr;
+		}
+
+		void AddFlat(TypeID typeId, DispMember dispMember)
+		{
+			m_members.push_back(dispMember);
+			m_flatTable[typeId] = static_cast<uint16_t>(m_members.size());
+		}
+
+		// A tag is in exactly one of the tables, so sparse entries the flat table now covers
+		// move over
+		void GrowFlatTable(size_t newSize)
+		{
+			m_flatTable.resize(newSize, 0);
+
+			auto itCovered = std::lower_bound(m_sparseTable.begin(), m_sparseTable.end(), newSize,
+				[](const SparseEntry& entry, size_t size) { return entry.first < size; });
+			auto itMoved = m_sparseTable.begin();
+			for (; itMoved != itCovered && m_members.size() < MAX_FLAT_ENTRIES; ++itMoved)
+			{
+				AddFlat(itMoved->first, itMoved->second);
+			}
+			m_sparseTable.erase(m_sparseTable.begin(), itMoved);
+		}
+
+		// One past the position in m_members, or zero where there is no dispatch
+		std::vector<uint16_t> m_flatTable;
+		std::vector<DispMember> m_members;
+		// Sorted by TypeID
+		std::vector<SparseEntry> m_sparseTable;
+		size_t m_entryCount{ 0 };
 	};
 
-}
\ No newline at end of file
+}
@@ -1,5 +1,7 @@
 #include "TypeTags.h"
 
+#include <mutex>
+
 namespace impl_ns = holder::base::types;
 
 impl_ns::TypeTagManager& impl_ns::TypeTagManager::GetInstance()
@@ -14,6 +16,11 @@ impl_ns::TypeTag impl_ns::TypeTagManager::GetType(const char* typeName)
 	return GetInstance().GetTypeInst(typeName);
 }
 
+std::string impl_ns::TypeTagManager::GetTypeName(const TypeTag& tag)
+{
+	return GetInstance().GetTypeNameInst(tag);
+}
+
 impl_ns::TypeTag impl_ns::TypeTagManager::GetTypeInst(const char* typeName)
 {
 	std::string sName(typeName);
@@ -21,7 +28,7 @@ impl_ns::TypeTag impl_ns::TypeTagManager::GetTypeInst(const char* typeName)
 	{
 		// First try shared
 		std::shared_lock lk(m_mutex);
-		auto itType = m_typeMap.find(typeName);
+		auto itType = m_typeMap.find(sName);
 		if (itType != m_typeMap.end())
 		{
 			return itType->second;
@@ -29,7 +36,7 @@ impl_ns::TypeTag impl_ns::TypeTagManager::GetTypeInst(const char* typeName)
 	}
 
 	std::unique_lock lk(m_mutex);
-	auto itType = m_typeMap.find(typeName);
+	auto itType = m_typeMap.find(sName);
 	// check again
 	if (itType != m_typeMap.end())
 	{
@@ -38,8 +45,21 @@ impl_ns::TypeTag impl_ns::TypeTagManager::GetTypeInst(const char* typeName)
 
 	// No?  Add
 	TypeID newTypeID = m_freeId++;
-	m_typeMap.emplace(typeName, TypeTag(newTypeID));
+	m_typeNames.emplace_back(sName);
+	m_typeMap.emplace(std::move(sName), TypeTag(newTypeID));
 
 	return TypeTag(newTypeID);
 
-}
\ No newline at end of file
+}
+
+std::string impl_ns::TypeTagManager::GetTypeNameInst(const TypeTag& tag) const
+{
+	std::shared_lock lk(m_mutex);
+	TypeID typeID = tag.GetID();
+	if (typeID == 0 || typeID > m_typeNames.size())
+	{
+		throw TypeNotFoundException();
+	}
+
+	return m_typeNames[typeID - 1];
+}
@@ -3,6 +3,7 @@
 #include <shared_mutex>
 #include <unordered_map>
 #include <string>
+#include <vector>
 #include <functional>
 
 namespace holder::base::types
@@ -29,6 +30,12 @@ namespace holder::base::types
 			return m_typeID == other.m_typeID;
 		}
 
+		// Dense, starting at 1, so it can index a table
+		TypeID GetID() const
+		{
+			return m_typeID;
+		}
+
 		std::size_t GetHash() const
 		{
 			static std::hash<TypeID> memberHash;
@@ -48,16 +55,39 @@ namespace holder::base::types
 	{
 	public:
 		static TypeTag GetType(const char* typeName);
+		// For diagnostics; the name the tag was registered under
+		static std::string GetTypeName(const TypeTag& tag);
 	private:
 		TypeTag GetTypeInst(const char* typeName);
+		std::string GetTypeNameInst(const TypeTag& tag) const;
 		
 		static TypeTagManager& GetInstance();
 
 		mutable std::shared_mutex m_mutex;
 		TypeID m_freeId{ 1 };
 		std::unordered_map<std::string, TypeTag> m_typeMap;
+		// Indexed by TypeID - 1
+		std::vector<std::string> m_typeNames;
+	};
+
+	// Gives a type the name its tag is registered under.  By default the type
+	// supplies it as a static TYPE_TAG_NAME member; specialize for types that can't.
+	// Types with the same name share a tag, also across processes
+	template<typename T>
+	struct TypeTagTraits
+	{
+		static constexpr const char* name = T::TYPE_TAG_NAME;
 	};
 
+	// The tag for T.  The manager is consulted once per type, on first use;
+	// after that this is a load of a function-local static
+	template<typename T>
+	TypeTag TypeTagOf()
+	{
+		static const TypeTag tag{ TypeTagManager::GetType(TypeTagTraits<T>::name) };
+		return tag;
+	}
+
 }
 
 namespace std
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "Messaging.h"
+
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace holder::messages
+{
+
+	// A family of messages carried as alternatives of one std::variant.  The family has a
+	// single tag, named by Family::TYPE_TAG_NAME, so the receiver does one dispatch lookup for
+	// the whole family and then picks the alternative with std::visit: a jump table, where
+	// separate message classes would each cost a tag lookup and a virtual call
+	template<typename Family, typename ... Payloads>
+	class VariantMessage : public IMessage
+	{
+	public:
+		using Payload = std::variant<Payloads...>;
+
+		// Not a copy or move constructor in disguise
+		template<typename P,
+			typename = std::enable_if_t<!std::is_same_v<std::decay_t<P>, VariantMessage> > >
+		explicit VariantMessage(P&& payload)
+			:m_payload(std::forward<P>(payload))
+		{ }
+
+		base::types::TypeTag GetTag() const override
+		{
+			return base::types::TypeTagOf<Family>();
+		}
+
+		Payload& GetPayload() { return m_payload; }
+		const Payload& GetPayload() const { return m_payload; }
+
+		template<typename Visitor>
+		decltype(auto) Visit(Visitor&& visitor)
+		{
+			return std::visit(std::forward<Visitor>(visitor), m_payload);
+		}
+
+	private:
+		Payload m_payload;
+	};
+
+	// Builds a visitor out of a set of lambdas
+	template<typename ... Fs>
+	struct Overloaded : Fs...
+	{
+		using Fs::operator()...;
+	};
+
+	template<typename ... Fs>
+	Overloaded(Fs...) -> Overloaded<Fs...>;
+
+	// Hands the payload of a message known to be a VariantMsg to the handler's
+	// OnPayload(Alternative&, DispatchID) overloads.  Meant to be called from the dispatch
+	// member registered for the family's tag
+	template<typename VariantMsg, typename Handler>
+	void VisitMessage(Handler& handler, IMessage& rMsg, DispatchID dispatchID)
+	{
+		static_cast<VariantMsg&>(rMsg).Visit([&handler, dispatchID](auto& payload)
+			{
+				handler.OnPayload(payload, dispatchID);
+			});
+	}
+
+}